@@ -3,8 +3,11 @@
 #ifndef SIMULAKE_COMPUTE_BASE_CL
 #define SIMULAKE_COMPUTE_BASE_CL
 
-// TODO(vir): benchmark?
-#define USE_ROWMAJOR true
+// grid layout, set by the device grid when it builds the program. 0 keeps
+// an array of grid_t, 1 one plane per attribute (see layout.cl)
+#ifndef USE_PLANES
+#define USE_PLANES 0
+#endif
 
 // clang-format off
 #define   NONE_TYPE         0
@@ -19,30 +22,31 @@
 #define   STONE_TYPE        9
 // clang-format on
 
-#define FALLS_DOWN(x) (x.type > WATER_TYPE)
-#define VACANT(x) (x.type == AIR_TYPE)
+// predicates on cell i of grid g
+#define FALLS_DOWN(g, i) (TYPE(g, i) > WATER_TYPE)
+#define VACANT(g, i) (TYPE(g, i) == AIR_TYPE)
 
 #define V_STATIONARY ((float2){0.0f, 0.0f})
 
-#define IS_FLUID(x)                                                            \
-  ((x.type >= AIR_TYPE && x.type <= OIL_TYPE) || (x.type == JET_FUEL_TYPE))
-#define IS_LIQUID(x) (x.type >= WATER_TYPE && x.type <= OIL_TYPE)
-#define IS_AIR(x) (x.type == AIR_TYPE)
-#define IS_SMOKE(x) (x.type == SMOKE_TYPE)
-#define IS_SAND(x) (x.type == SAND_TYPE)
-#define IS_WATER(x) (x.type == WATER_TYPE)
-#define IS_JET_FUEL(x) (x.type == JET_FUEL_TYPE)
-#define IS_OIL(x) (x.type == OIL_TYPE)
-#define IS_FLAMMABLE(x)                                                        \
-  (x.type >= AIR_TYPE && (x.type == OIL_TYPE || x.type == SAND_TYPE))
+#define IS_FLUID(g, i)                                                         \
+  ((TYPE(g, i) >= AIR_TYPE && TYPE(g, i) <= OIL_TYPE) ||                       \
+   (TYPE(g, i) == JET_FUEL_TYPE))
+#define IS_LIQUID(g, i) (TYPE(g, i) >= WATER_TYPE && TYPE(g, i) <= OIL_TYPE)
+#define IS_AIR(g, i) (TYPE(g, i) == AIR_TYPE)
+#define IS_SMOKE(g, i) (TYPE(g, i) == SMOKE_TYPE)
+#define IS_SAND(g, i) (TYPE(g, i) == SAND_TYPE)
+#define IS_WATER(g, i) (TYPE(g, i) == WATER_TYPE)
+#define IS_JET_FUEL(g, i) (TYPE(g, i) == JET_FUEL_TYPE)
+#define IS_OIL(g, i) (TYPE(g, i) == OIL_TYPE)
+#define IS_FLAMMABLE(g, i)                                                     \
+  (TYPE(g, i) >= AIR_TYPE &&                                                   \
+   (TYPE(g, i) == OIL_TYPE || TYPE(g, i) == SAND_TYPE))
 
 #define FCLAMP(x, l, h) (fmax((float)l, fmin((float)x, (float)h)))
 
-#if USE_ROWMAJOR
-#define GET_INDEX(row, col, width, height) (((col) * (height)) + (row))
-#else
+// row major: work items next to each other along dimension 0 (columns) read
+// cells next to each other, so their loads coalesce
 #define GET_INDEX(row, col, width, height) (((row) * (width)) + (col))
-#endif
 
 // clang-format off
 #define   AIR_MASS        0.0f
@@ -68,37 +72,47 @@
       printf("assert_fail: (%s) was true @ %d\n", #x, __LINE__);               \
   }
 
-// get a random number (0, UINT_MAX) using xor shift
-inline uint get_rand(__global ulong *seed) {
-  // xorshift
-  // const uint seed = seed + row;
-  // const uint t = seed ^ (seed << 11);
-  // return (col) ^ ((col) >> 19) ^ (t ^ (t >> 8));
+// NOTE(vir): DO NOT REMOVE --- x0
+#include "random.cl"
 
-  // java random
-  *seed = ((*seed) * 0x5DEECE66DL + 0xBL) & ((1L << 48) - 1);
-  return (*seed) >> 16;
+// NOTE(vir): DO NOT REMOVE --- x0
+#include "layout.cl"
+
+// random stream of a single work item, see random.cl
+typedef struct {
+  ulong key;
+  ulong counter;
+} rng_t;
+
+inline rng_t rng_init(const ulong key, const uint col, const uint row) {
+  const rng_t rng = {key, rng_cell_counter(col, row)};
+  return rng;
 }
 
-inline float get_rand_float(__global ulong *seed_) {
-  return ((float)get_rand(seed_)) / ((float)UINT_MAX);
+// get a random number (0, UINT_MAX)
+inline uint get_rand(rng_t *rng) {
+  return rng_squares32(rng->counter++, rng->key);
+}
+
+inline float get_rand_float(rng_t *rng) {
+  return rng_to_float(get_rand(rng));
 }
 
 #define SCALE_FLOAT(f, low, high) ((f - 1.0f) / (1.0f)) * (high - low) + low
 
-inline float get_mass(const uint type, __global ulong *random_seed) {
+inline float get_mass(const uint type, rng_t *rng) {
   switch (type) {
   case SMOKE_TYPE:
-    return get_rand_float(random_seed);
+    return get_rand_float(rng);
     break;
   case FIRE_TYPE:
-    return SCALE_FLOAT(get_rand_float(random_seed), 0.7f, FIRE_MASS);
+    return SCALE_FLOAT(get_rand_float(rng), 0.7f, FIRE_MASS);
     break;
   case GREEK_FIRE_TYPE:
-    return SCALE_FLOAT(get_rand_float(random_seed), 0.2f, GREEK_FIRE_MASS);
+    return SCALE_FLOAT(get_rand_float(rng), 0.2f, GREEK_FIRE_MASS);
     break;
   case WATER_TYPE:
-    return get_rand_float(random_seed);
+    return get_rand_float(rng);
     break;
   case OIL_TYPE:
     return OIL_MASS;
@@ -107,7 +121,7 @@ inline float get_mass(const uint type, __global ulong *random_seed) {
     return SAND_MASS;
     break;
   case JET_FUEL_TYPE:
-    return SCALE_FLOAT(get_rand_float(random_seed), 0.3f, GREEK_FIRE_MASS);
+    return SCALE_FLOAT(get_rand_float(rng), 0.3f, GREEK_FIRE_MASS);
     break;
 
   case AIR_TYPE:
@@ -117,7 +131,6 @@ inline float get_mass(const uint type, __global ulong *random_seed) {
 }
 
 // cell attributes
-// TODO(vir): benchmark?
 typedef struct __attribute__((packed, aligned(8))) {
   char type;
   float mass;
@@ -126,6 +139,60 @@ typedef struct __attribute__((packed, aligned(8))) {
   bool updated;
 } grid_t;
 
+// kernels take grid buffers as grid_buffer_t and access them through a
+// grid_ref_t (see GRID_REF), with TYPE, MASS, VELOCITY and UPDATED of cell i
+#if USE_PLANES
+typedef __global uchar *grid_buffer_t;
+
+typedef struct {
+  __global char *type;
+  __global float *mass;
+  __global float2 *velocity;
+  __global uchar *updated;
+} grid_ref_t;
+
+inline grid_ref_t grid_planes(grid_buffer_t buffer, const uint2 dims) {
+  const uint num_cells = dims[0] * dims[1];
+  const grid_ref_t grid = {
+      (__global char *)buffer,
+      (__global float *)(buffer + grid_mass_offset(num_cells)),
+      (__global float2 *)(buffer + grid_velocity_offset(num_cells)),
+      (__global uchar *)(buffer + grid_updated_offset(num_cells)),
+  };
+  return grid;
+}
+
+#define GRID_REF(buffer, dims) grid_planes(buffer, dims)
+
+#define TYPE(g, i) ((g).type[i])
+#define MASS(g, i) ((g).mass[i])
+#define VELOCITY(g, i) ((g).velocity[i])
+#define UPDATED(g, i) ((g).updated[i])
+#else
+typedef __global grid_t *grid_buffer_t;
+typedef __global grid_t *grid_ref_t;
+
+#define GRID_REF(buffer, dims) (buffer)
+
+#define TYPE(g, i) ((g)[i].type)
+#define MASS(g, i) ((g)[i].mass)
+#define VELOCITY(g, i) ((g)[i].velocity)
+#define UPDATED(g, i) ((g)[i].updated)
+#endif
+
+#define COPY_CELL(to, from, i)                                                 \
+  {                                                                            \
+    TYPE(to, i) = TYPE(from, i);                                               \
+    MASS(to, i) = MASS(from, i);                                               \
+    VELOCITY(to, i) = VELOCITY(from, i);                                       \
+    UPDATED(to, i) = UPDATED(from, i);                                         \
+  }
+
+// grid and next_grid of a kernel taking grid_buffer and next_grid_buffer
+#define GEN_GRID_REFS()                                                        \
+  const grid_ref_t grid = GRID_REF(grid_buffer, dims);                         \
+  const grid_ref_t next_grid = GRID_REF(next_grid_buffer, dims);
+
 #define GEN_NEIGHBOUR_INDICES(row, col, width, height)                         \
   const uint idx_top_left = GET_INDEX(row - 1, col - 1, width, height);        \
   const uint idx_top = GET_INDEX(row - 1, col + 0, width, height);             \
@@ -147,11 +214,20 @@ typedef struct __attribute__((packed, aligned(8))) {
   const uint col = get_global_id(0);                                           \
   const uint row = get_global_id(1);
 
+#define GEN_RNG() rng_t rng = rng_init(key, col, row);
+
+// work group of the current work item, in row major order
+#define GET_TILE_INDEX()                                                       \
+  (get_group_id(1) * get_num_groups(0) + get_group_id(0))
+
+// a step sets *wrote when it changes next_grid, see carry_forward
 #define STEP_IMPL(name)                                                        \
-  inline void name(__global ulong *seed, const uint2 loc, const uint2 dims,    \
-                   __global grid_t *grid, __global grid_t *next_grid)
+  inline void name(rng_t *rng, const uint2 loc, const uint2 dims,              \
+                   grid_ref_t grid, grid_ref_t next_grid, bool *wrote)
+
+#define INVOKE_IMPL(name) name(&rng, loc, dims, grid, next_grid, &wrote)
 
-#define INVOKE_IMPL(name) name(&seeds[idx], loc, dims, grid, next_grid)
+#define MARK_WRITTEN() (*wrote = true)
 
 #define GEN_STEP_LOC()                                                         \
   const uint row = loc[0];                                                     \
@@ -163,6 +239,6 @@ typedef struct __attribute__((packed, aligned(8))) {
   GEN_STEP_LOC();                                                              \
   GEN_BOUNDS_VALID(row, col, width, height);                                   \
   GEN_NEIGHBOUR_INDICES(row, col, width, height);                              \
-  const uint type = (int)grid[idx].type;
+  const uint type = (int)TYPE(grid, idx);
 
 #endif
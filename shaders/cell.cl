@@ -11,52 +11,55 @@ STEP_IMPL(smoke_step) {
 
 #define __move_smoke__(idx_next)                                               \
   {                                                                            \
-    next_grid[idx].type = AIR_TYPE;                                            \
-    next_grid[idx].mass = AIR_MASS;                                            \
-    next_grid[idx].velocity = V_STATIONARY;                                    \
-    next_grid[idx].updated = false;                                            \
-    next_grid[idx_next].type = SMOKE_TYPE;                                     \
-    next_grid[idx_next].mass = grid[idx].mass - mass_decay;                    \
-    next_grid[idx_next].velocity = grid[idx].velocity;                         \
-    next_grid[idx_next].updated = false;                                       \
-    grid[idx].updated = true;                                                  \
-    grid[idx_next].updated = true;                                             \
+    TYPE(next_grid, idx) = AIR_TYPE;                                           \
+    MASS(next_grid, idx) = AIR_MASS;                                           \
+    VELOCITY(next_grid, idx) = V_STATIONARY;                                   \
+    UPDATED(next_grid, idx) = false;                                           \
+    TYPE(next_grid, idx_next) = SMOKE_TYPE;                                    \
+    MASS(next_grid, idx_next) = MASS(grid, idx) - mass_decay;                  \
+    VELOCITY(next_grid, idx_next) = VELOCITY(grid, idx);                       \
+    UPDATED(next_grid, idx_next) = false;                                      \
+    UPDATED(grid, idx) = true;                                                 \
+    UPDATED(grid, idx_next) = true;                                            \
     moved = true;                                                              \
+    MARK_WRITTEN();                                                            \
   }
 
   const float p = 0.4f;
   const float min_mass = 0.0f;
   const float mass_decay = 0.015f;
 
-  const bool decayed = grid[idx].mass <= min_mass;
+  const bool decayed = MASS(grid, idx) <= min_mass;
   bool moved = false;
 
   if (decayed) {
-    next_grid[idx].type = AIR_TYPE;
-    next_grid[idx].mass = AIR_MASS;
-    next_grid[idx].velocity = V_STATIONARY;
-    next_grid[idx].updated = false;
-    grid[idx].updated = true;
+    TYPE(next_grid, idx) = AIR_TYPE;
+    MASS(next_grid, idx) = AIR_MASS;
+    VELOCITY(next_grid, idx) = V_STATIONARY;
+    UPDATED(next_grid, idx) = false;
+    UPDATED(grid, idx) = true;
 
     moved = true;
+    MARK_WRITTEN();
   }
 
   else if (top_valid) {
-    if (get_rand_float(seed) > p)
+    if (get_rand_float(rng) > p)
       return;
 
     // clang-format off
-    if      (               IS_FLUID(grid[idx_top]))       { __move_smoke__(idx_top);       }
-    else if (left_valid  && IS_FLUID(grid[idx_top_left]))  { __move_smoke__(idx_top_left);  }
-    else if (right_valid && IS_FLUID(grid[idx_top_right])) { __move_smoke__(idx_top_right); }
+    if      (               IS_FLUID(grid, idx_top))       { __move_smoke__(idx_top);       }
+    else if (left_valid  && IS_FLUID(grid, idx_top_left))  { __move_smoke__(idx_top_left);  }
+    else if (right_valid && IS_FLUID(grid, idx_top_right)) { __move_smoke__(idx_top_right); }
     // clang-format on
   }
 
   // decay in place
   if (!moved) {
-    next_grid[idx].mass = grid[idx].mass - mass_decay;
-    next_grid[idx].updated = false;
-    grid[idx].updated = true;
+    MASS(next_grid, idx) = MASS(grid, idx) - mass_decay;
+    UPDATED(next_grid, idx) = false;
+    UPDATED(grid, idx) = true;
+    MARK_WRITTEN();
   }
 }
 
@@ -64,32 +67,35 @@ STEP_IMPL(fire_step) {
   GEN_STEP_IMPL_HEADER();
 
 #define __to_fire_or_smoke__(target, r, c)                                     \
-  if (IS_FLAMMABLE(grid[target])) {                                            \
-    next_grid[target].type = FIRE_TYPE;                                        \
-    next_grid[target].mass = remaining_mass;                                   \
-    next_grid[target].velocity = V_STATIONARY;                                 \
-    next_grid[target].updated = false;                                         \
-    grid[idx].updated = true;                                                  \
-  } else if (IS_AIR(grid[target]) && get_rand_float(seed) < p) {               \
-    next_grid[target].type = SMOKE_TYPE;                                       \
-    next_grid[target].mass = remaining_mass - mass_decay;                      \
-    next_grid[target].velocity = grid[idx].velocity;                           \
-    next_grid[target].updated = false;                                         \
-    grid[idx].updated = true;                                                  \
+  if (IS_FLAMMABLE(grid, target)) {                                            \
+    TYPE(next_grid, target) = FIRE_TYPE;                                       \
+    MASS(next_grid, target) = remaining_mass;                                  \
+    VELOCITY(next_grid, target) = V_STATIONARY;                                \
+    UPDATED(next_grid, target) = false;                                        \
+    UPDATED(grid, idx) = true;                                                 \
+  } else if (IS_AIR(grid, target) && get_rand_float(rng) < p) {                \
+    TYPE(next_grid, target) = SMOKE_TYPE;                                      \
+    MASS(next_grid, target) = remaining_mass - mass_decay;                     \
+    VELOCITY(next_grid, target) = VELOCITY(grid, idx);                         \
+    UPDATED(next_grid, target) = false;                                        \
+    UPDATED(grid, idx) = true;                                                 \
   }
 
   const float p = 0.4f;
   const float min_mass = 0.0f;
   const float mass_decay = 0.05f;
 
-  const float remaining_mass = grid[idx].mass - mass_decay;
+  const float remaining_mass = MASS(grid, idx) - mass_decay;
+
+  // burns down every step
+  MARK_WRITTEN();
 
   if (remaining_mass <= min_mass) {
-    next_grid[idx].type = SMOKE_TYPE;
-    next_grid[idx].mass = SMOKE_MASS;
-    next_grid[idx].velocity = grid[idx].velocity;
-    next_grid[idx].updated = false;
-    grid[idx].updated = true;
+    TYPE(next_grid, idx) = SMOKE_TYPE;
+    MASS(next_grid, idx) = SMOKE_MASS;
+    VELOCITY(next_grid, idx) = VELOCITY(grid, idx);
+    UPDATED(next_grid, idx) = false;
+    UPDATED(grid, idx) = true;
     return;
   }
 
@@ -107,43 +113,46 @@ STEP_IMPL(fire_step) {
   }
   // clang-format on
 
-  next_grid[idx].type = FIRE_TYPE;
-  next_grid[idx].mass = fmax(0.0f, remaining_mass);
-  next_grid[idx].velocity = V_STATIONARY;
-  next_grid[idx].updated = false;
-  grid[idx].updated = true;
+  TYPE(next_grid, idx) = FIRE_TYPE;
+  MASS(next_grid, idx) = fmax(0.0f, remaining_mass);
+  VELOCITY(next_grid, idx) = V_STATIONARY;
+  UPDATED(next_grid, idx) = false;
+  UPDATED(grid, idx) = true;
 }
 
 STEP_IMPL(greek_fire_step) {
   GEN_STEP_IMPL_HEADER();
 
 #define __to_greek_fire_or_smoke__(target, r, c)                               \
-  if (IS_FLAMMABLE(grid[target])) {                                            \
-    next_grid[target].type = FIRE_TYPE;                                        \
-    next_grid[target].mass = remaining_mass;                                   \
-    next_grid[target].velocity = V_STATIONARY;                                 \
-    next_grid[target].updated = false;                                         \
-    grid[idx].updated = true;                                                  \
-  } else if (IS_AIR(grid[target]) && get_rand_float(seed) < p) {               \
-    next_grid[target].type = SMOKE_TYPE;                                       \
-    next_grid[target].mass = get_mass(SMOKE_TYPE, seed);                       \
-    next_grid[target].velocity = grid[idx].velocity;                           \
-    next_grid[target].updated = false;                                         \
-    grid[idx].updated = true;                                                  \
+  if (IS_FLAMMABLE(grid, target)) {                                            \
+    TYPE(next_grid, target) = FIRE_TYPE;                                       \
+    MASS(next_grid, target) = remaining_mass;                                  \
+    VELOCITY(next_grid, target) = V_STATIONARY;                                \
+    UPDATED(next_grid, target) = false;                                        \
+    UPDATED(grid, idx) = true;                                                 \
+  } else if (IS_AIR(grid, target) && get_rand_float(rng) < p) {                \
+    TYPE(next_grid, target) = SMOKE_TYPE;                                      \
+    MASS(next_grid, target) = get_mass(SMOKE_TYPE, rng);                       \
+    VELOCITY(next_grid, target) = VELOCITY(grid, idx);                         \
+    UPDATED(next_grid, target) = false;                                        \
+    UPDATED(grid, idx) = true;                                                 \
   }
 
   const float p = 0.4f;
   const float min_mass = 0.0f;
   const float mass_decay = 0.05f;
 
-  const float remaining_mass = grid[idx].mass - mass_decay;
+  const float remaining_mass = MASS(grid, idx) - mass_decay;
+
+  // burns down every step
+  MARK_WRITTEN();
 
   if (remaining_mass <= min_mass) {
-    next_grid[idx].type = GREEK_FIRE_TYPE;
-    next_grid[idx].mass = get_mass(GREEK_FIRE_TYPE, seed);
-    next_grid[idx].velocity = grid[idx].velocity;
-    next_grid[idx].updated = false;
-    grid[idx].updated = true;
+    TYPE(next_grid, idx) = GREEK_FIRE_TYPE;
+    MASS(next_grid, idx) = get_mass(GREEK_FIRE_TYPE, rng);
+    VELOCITY(next_grid, idx) = VELOCITY(grid, idx);
+    UPDATED(next_grid, idx) = false;
+    UPDATED(grid, idx) = true;
     return;
   }
 
@@ -161,81 +170,84 @@ STEP_IMPL(greek_fire_step) {
   }
   // clang-format on
 
-  next_grid[idx].type = GREEK_FIRE_TYPE;
-  next_grid[idx].mass = fmax(0.0f, remaining_mass);
-  next_grid[idx].velocity = V_STATIONARY;
-  next_grid[idx].updated = false;
-  grid[idx].updated = true;
+  TYPE(next_grid, idx) = GREEK_FIRE_TYPE;
+  MASS(next_grid, idx) = fmax(0.0f, remaining_mass);
+  VELOCITY(next_grid, idx) = V_STATIONARY;
+  UPDATED(next_grid, idx) = false;
+  UPDATED(grid, idx) = true;
 }
 
 STEP_IMPL(jet_fuel_step) {
   GEN_STEP_IMPL_HEADER();
 
-  grid[idx].updated = true;
-  next_grid[idx].updated = false;
+  // never at rest, it falls, spreads or ignites
+  MARK_WRITTEN();
+
+  UPDATED(grid, idx) = true;
+  UPDATED(next_grid, idx) = false;
 
-  if (top_valid && IS_FLAMMABLE(grid[idx_top]) && get_rand(seed) % 10 < 3) {
-    next_grid[idx].type = FIRE_TYPE;
-    next_grid[idx].mass = SCALE_FLOAT(get_rand_float(seed), 0.7f, 4.0f);
-    next_grid[idx].velocity = V_STATIONARY;
+  if (top_valid && IS_FLAMMABLE(grid, idx_top) && get_rand(rng) % 10 < 3) {
+    TYPE(next_grid, idx) = FIRE_TYPE;
+    MASS(next_grid, idx) = SCALE_FLOAT(get_rand_float(rng), 0.7f, 4.0f);
+    VELOCITY(next_grid, idx) = V_STATIONARY;
     return;
   }
 
-  if (top_valid && IS_WATER(grid[idx_top])) {
-    next_grid[idx].type = SMOKE_TYPE;
-    next_grid[idx].mass = get_mass(SMOKE_TYPE, seed);
-    next_grid[idx].velocity = V_STATIONARY;
+  if (top_valid && IS_WATER(grid, idx_top)) {
+    TYPE(next_grid, idx) = SMOKE_TYPE;
+    MASS(next_grid, idx) = get_mass(SMOKE_TYPE, rng);
+    VELOCITY(next_grid, idx) = V_STATIONARY;
     return;
   }
 
-  if (bot_valid && IS_JET_FUEL(grid[idx_bot]) && get_rand(seed) % 100 < 100) {
-    next_grid[idx].type = FIRE_TYPE;
-    next_grid[idx].mass = SCALE_FLOAT(get_rand_float(seed), 0.7f, 4.0f);
-    next_grid[idx].velocity = V_STATIONARY;
+  if (bot_valid && IS_JET_FUEL(grid, idx_bot) && get_rand(rng) % 100 < 100) {
+    TYPE(next_grid, idx) = FIRE_TYPE;
+    MASS(next_grid, idx) = SCALE_FLOAT(get_rand_float(rng), 0.7f, 4.0f);
+    VELOCITY(next_grid, idx) = V_STATIONARY;
     return;
   }
 
-  if (bot_valid && !IS_FLUID(grid[idx_bot]) && get_rand(seed) % 10 < 5) {
-    next_grid[idx].type = FIRE_TYPE;
-    next_grid[idx].mass = SCALE_FLOAT(get_rand_float(seed), 0.5f, 4.0f);
-    next_grid[idx].velocity = V_STATIONARY;
+  if (bot_valid && !IS_FLUID(grid, idx_bot) && get_rand(rng) % 10 < 5) {
+    TYPE(next_grid, idx) = FIRE_TYPE;
+    MASS(next_grid, idx) = SCALE_FLOAT(get_rand_float(rng), 0.5f, 4.0f);
+    VELOCITY(next_grid, idx) = V_STATIONARY;
     return;
   }
 
-  if (bot_valid && (IS_AIR(grid[idx_bot]) || IS_SMOKE(grid[idx_bot]))) {
-    next_grid[idx_bot].type = JET_FUEL_TYPE;
-    next_grid[idx_bot].mass = grid[idx].mass;
-    next_grid[idx_bot].velocity = grid[idx].velocity;
-    next_grid[idx_bot].updated = false;
+  if (bot_valid && (IS_AIR(grid, idx_bot) || IS_SMOKE(grid, idx_bot))) {
+    TYPE(next_grid, idx_bot) = JET_FUEL_TYPE;
+    MASS(next_grid, idx_bot) = MASS(grid, idx);
+    VELOCITY(next_grid, idx_bot) = VELOCITY(grid, idx);
+    UPDATED(next_grid, idx_bot) = false;
 
-    next_grid[idx].type = AIR_TYPE;
-    next_grid[idx].mass = AIR_MASS;
-    next_grid[idx].velocity = V_STATIONARY;
+    TYPE(next_grid, idx) = AIR_TYPE;
+    MASS(next_grid, idx) = AIR_MASS;
+    VELOCITY(next_grid, idx) = V_STATIONARY;
 
-    grid[idx_bot].updated = true;
+    UPDATED(grid, idx_bot) = true;
     return;
   }
 
-  const int direction = get_rand(seed) % 2 == 0 ? -1 : 1;
+  const int direction = get_rand(rng) % 2 == 0 ? -1 : 1;
   const bool dir_valid = direction == -1 ? top_valid : bot_valid;
   const int next_idx = GET_INDEX(row + direction, col, width, height);
-  if (dir_valid && (IS_AIR(grid[next_idx]) || IS_SMOKE(grid[next_idx]))) {
-    next_grid[next_idx].type = JET_FUEL_TYPE;
-    next_grid[next_idx].mass = grid[idx].mass;
-    next_grid[next_idx].velocity = grid[idx].velocity;
-    next_grid[next_idx].updated = false;
+  if (dir_valid && (IS_AIR(grid, next_idx) || IS_SMOKE(grid, next_idx))) {
+    TYPE(next_grid, next_idx) = JET_FUEL_TYPE;
+    MASS(next_grid, next_idx) = MASS(grid, idx);
+    VELOCITY(next_grid, next_idx) = VELOCITY(grid, idx);
+    UPDATED(next_grid, next_idx) = false;
 
-    next_grid[idx].type = AIR_TYPE;
-    next_grid[idx].mass = AIR_MASS;
-    next_grid[idx].velocity = V_STATIONARY;
+    TYPE(next_grid, idx) = AIR_TYPE;
+    MASS(next_grid, idx) = AIR_MASS;
+    VELOCITY(next_grid, idx) = V_STATIONARY;
 
-    grid[next_idx].updated = true;
+    UPDATED(grid, next_idx) = true;
     return;
   }
 
-  next_grid[idx].type = JET_FUEL_TYPE;
-  next_grid[idx].mass = grid[idx].mass;
-  next_grid[idx].velocity = grid[idx].velocity;
+  TYPE(next_grid, idx) = JET_FUEL_TYPE;
+  MASS(next_grid, idx) = MASS(grid, idx);
+  VELOCITY(next_grid, idx) = VELOCITY(grid, idx);
 }
 
 STEP_IMPL(stone_step) {}
@@ -264,43 +276,49 @@ STEP_IMPL(oil_step) {
   const int horizontal_reach = 2;
   const int bot_reach = 2;
 
-  if (next_grid[idx].updated)
-    next_grid[idx].mass = grid[idx].mass;
+  if (UPDATED(next_grid, idx))
+    MASS(next_grid, idx) = MASS(grid, idx);
 
   // mark cell calculated
-  next_grid[idx].updated = false;
-  next_grid[idx].type = OIL_TYPE;
-  grid[idx].updated = true;
+  UPDATED(next_grid, idx) = false;
+  TYPE(next_grid, idx) = OIL_TYPE;
+  UPDATED(grid, idx) = true;
 
-  float remaining_mass = next_grid[idx].mass;
+  float remaining_mass = MASS(next_grid, idx);
   if (remaining_mass <= min_mass) {
-    next_grid[idx].type = AIR_TYPE;
-    next_grid[idx].mass = AIR_MASS;
+    TYPE(next_grid, idx) = AIR_TYPE;
+    MASS(next_grid, idx) = AIR_MASS;
+    MARK_WRITTEN();
     return;
   }
 
   // downward flow
   if (bot_valid
-          && IS_FLUID(grid[idx_bot])
-          && !IS_WATER(grid[idx_bot])
-          && !IS_WATER(next_grid[idx_bot])
-          && !IS_SAND(next_grid[idx_bot])) {
-    next_grid[idx_bot].type = OIL_TYPE;
-    next_grid[idx_bot].updated = false;
-
+          && IS_FLUID(grid, idx_bot)
+          && !IS_WATER(grid, idx_bot)
+          && !IS_WATER(next_grid, idx_bot)
+          && !IS_SAND(next_grid, idx_bot)) {
     float flow =
-        fluid_get_stable_state(remaining_mass + next_grid[idx_bot].mass) -
-        next_grid[idx_bot].mass;
+        fluid_get_stable_state(remaining_mass + MASS(next_grid, idx_bot)) -
+        MASS(next_grid, idx_bot);
     flow *= flow > min_flow ? dampen : 1.f;
     flow = FCLAMP(flow, 0, fmin(max_speed, remaining_mass));
 
+    // only a cell mass flows into turns liquid
+    if (flow > 0.0f) {
+      TYPE(next_grid, idx_bot) = OIL_TYPE;
+      UPDATED(next_grid, idx_bot) = false;
+      MARK_WRITTEN();
+    }
+
     remaining_mass -= flow;
-    next_grid[idx].mass -= flow;
-    next_grid[idx_bot].mass += flow;
+    MASS(next_grid, idx) -= flow;
+    MASS(next_grid, idx_bot) += flow;
 
     if (remaining_mass <= min_mass) {
-      next_grid[idx].type = AIR_TYPE;
-      next_grid[idx].mass = AIR_MASS;
+      TYPE(next_grid, idx) = AIR_TYPE;
+      MASS(next_grid, idx) = AIR_MASS;
+      MARK_WRITTEN();
       return;
     }
   }
@@ -311,43 +329,49 @@ STEP_IMPL(oil_step) {
          left >= ((int)col - bot_reach) && left >= 0 && (row + down) < height;
          left -= 1, down += 1) {
       const uint next_idx = GET_INDEX(row + down, left, width, height);
-      if (!IS_FLUID(grid[next_idx])
-              || IS_WATER(grid[next_idx])
-              || IS_SAND(next_grid[next_idx]))
+      if (!IS_FLUID(grid, next_idx)
+              || IS_WATER(grid, next_idx)
+              || IS_SAND(next_grid, next_idx))
         break;
 
-      float flow = (next_grid[idx].mass - next_grid[next_idx].mass);
+      float flow = (MASS(next_grid, idx) - MASS(next_grid, next_idx));
       flow *= flow > min_flow ? dampen : 1.f;
-      flow = FCLAMP(flow, 0, next_grid[idx].mass);
+      flow = FCLAMP(flow, 0, MASS(next_grid, idx));
 
       remaining_mass -= flow;
 
       // if the block below is sand, 30% chance it'll get displaced to the
       // bottom right.
-      if (IS_SAND(next_grid[idx_bot]) && remaining_mass > 0.01f &&
-          get_rand(seed) % 10 == 0) {
+      if (IS_SAND(next_grid, idx_bot) && remaining_mass > 0.01f &&
+          get_rand(rng) % 10 == 0) {
+        MARK_WRITTEN();
+
         // new sand block to the bottom left.
-        next_grid[next_idx].type = SAND_TYPE;
-        next_grid[next_idx].mass = SAND_MASS;
-        next_grid[next_idx].updated = false;
+        TYPE(next_grid, next_idx) = SAND_TYPE;
+        MASS(next_grid, next_idx) = SAND_MASS;
+        UPDATED(next_grid, next_idx) = false;
 
         // new oil block below.
-        next_grid[idx].mass -= flow;
-        next_grid[idx_bot].type = OIL_TYPE;
-        next_grid[idx_bot].mass = flow;
-        next_grid[idx_bot].updated = false;
+        MASS(next_grid, idx) -= flow;
+        TYPE(next_grid, idx_bot) = OIL_TYPE;
+        MASS(next_grid, idx_bot) = flow;
+        UPDATED(next_grid, idx_bot) = false;
         break;
       } else {
-        next_grid[next_idx].type = OIL_TYPE;
-        next_grid[next_idx].updated = false;
-        next_grid[next_idx].mass += flow;
-        next_grid[idx].mass -= flow;
+        if (flow > 0.0f || !IS_OIL(next_grid, next_idx))
+          MARK_WRITTEN();
+
+        TYPE(next_grid, next_idx) = OIL_TYPE;
+        UPDATED(next_grid, next_idx) = false;
+        MASS(next_grid, next_idx) += flow;
+        MASS(next_grid, idx) -= flow;
       }
     }
 
     if (remaining_mass <= min_mass) {
-      next_grid[idx].type = AIR_TYPE;
-      next_grid[idx].mass = AIR_MASS;
+      TYPE(next_grid, idx) = AIR_TYPE;
+      MASS(next_grid, idx) = AIR_MASS;
+      MARK_WRITTEN();
       return;
     }
 
@@ -357,44 +381,50 @@ STEP_IMPL(oil_step) {
          (row + down) < height;
          right += 1, down += 1) {
       const uint next_idx = GET_INDEX(row + down, right, width, height);
-      if (!IS_FLUID(next_grid[next_idx])
-              || IS_WATER(grid[next_idx])
-              || IS_SAND(next_grid[next_idx]))
+      if (!IS_FLUID(next_grid, next_idx)
+              || IS_WATER(grid, next_idx)
+              || IS_SAND(next_grid, next_idx))
         break;
 
-      float flow = (next_grid[idx].mass - next_grid[next_idx].mass);
+      float flow = (MASS(next_grid, idx) - MASS(next_grid, next_idx));
       flow *= flow > min_flow ? dampen : 1.f;
-      flow = FCLAMP(flow, 0, next_grid[idx].mass);
+      flow = FCLAMP(flow, 0, MASS(next_grid, idx));
 
       remaining_mass -= flow;
 
       // if the block below is sand, 30% chance it'll get displaced to the
       // bottom left
-      if (IS_SAND(next_grid[idx_bot]) && remaining_mass > 0.01f &&
-          get_rand(seed) % 10 == 0) {
+      if (IS_SAND(next_grid, idx_bot) && remaining_mass > 0.01f &&
+          get_rand(rng) % 10 == 0) {
+        MARK_WRITTEN();
+
         // new sand block to the bottom left
-        next_grid[next_idx].type = SAND_TYPE;
-        next_grid[next_idx].mass = SAND_MASS;
-        next_grid[next_idx].updated = false;
+        TYPE(next_grid, next_idx) = SAND_TYPE;
+        MASS(next_grid, next_idx) = SAND_MASS;
+        UPDATED(next_grid, next_idx) = false;
 
         // new water block below
-        next_grid[idx].mass -= flow;
-        next_grid[idx_bot].type = OIL_TYPE;
-        next_grid[idx_bot].mass = flow;
-        next_grid[idx_bot].updated = false;
+        MASS(next_grid, idx) -= flow;
+        TYPE(next_grid, idx_bot) = OIL_TYPE;
+        MASS(next_grid, idx_bot) = flow;
+        UPDATED(next_grid, idx_bot) = false;
         break;
 
       } else {
-        next_grid[next_idx].type = OIL_TYPE;
-        next_grid[next_idx].updated = false;
-        next_grid[next_idx].mass += flow;
-        next_grid[idx].mass -= flow;
+        if (flow > 0.0f || !IS_OIL(next_grid, next_idx))
+          MARK_WRITTEN();
+
+        TYPE(next_grid, next_idx) = OIL_TYPE;
+        UPDATED(next_grid, next_idx) = false;
+        MASS(next_grid, next_idx) += flow;
+        MASS(next_grid, idx) -= flow;
       }
     }
 
     if (remaining_mass <= min_mass) {
-      next_grid[idx].type = AIR_TYPE;
-      next_grid[idx].mass = AIR_MASS;
+      TYPE(next_grid, idx) = AIR_TYPE;
+      MASS(next_grid, idx) = AIR_MASS;
+      MARK_WRITTEN();
       return;
     }
   }
@@ -409,36 +439,36 @@ STEP_IMPL(oil_step) {
     // find left bound
     for (; left >= max((int)col - horizontal_reach, 0); left -= 1) {
       const uint idx = GET_INDEX(row, left, width, height);
-      if (!IS_FLUID(next_grid[idx])
-              || IS_WATER(next_grid[idx])
-              || IS_SAND(next_grid[idx]))
+      if (!IS_FLUID(next_grid, idx)
+              || IS_WATER(next_grid, idx)
+              || IS_SAND(next_grid, idx))
         break;
 
-      mass_left += next_grid[idx].mass;
+      mass_left += MASS(next_grid, idx);
     }
 
     // find right bound
     for (; right <= min(col + horizontal_reach, width - 1); right += 1) {
       const uint idx = GET_INDEX(row, right, width, height);
-      if (!IS_FLUID(next_grid[idx])
-              || IS_WATER(next_grid[idx])
-              || IS_SAND(next_grid[idx]))
+      if (!IS_FLUID(next_grid, idx)
+              || IS_WATER(next_grid, idx)
+              || IS_SAND(next_grid, idx))
         break;
 
-      mass_right += next_grid[idx].mass;
+      mass_right += MASS(next_grid, idx);
     }
 
     // correct
     left++;
     right--;
 
-    float mean_mass = (mass_left + mass_right + next_grid[idx].mass);
+    float mean_mass = (mass_left + mass_right + MASS(next_grid, idx));
     mean_mass /= (right - left + 1);
 
 #ifdef DEBUG
     if (mean_mass < 0.0f) {
       printf("%f-%f-%f-%f\n", mean_mass, mass_left, mass_right,
-             next_grid[idx].mass);
+             MASS(next_grid, idx));
 
     } else {
 #endif
@@ -447,10 +477,13 @@ STEP_IMPL(oil_step) {
   {                                                                            \
     for (init; cond; update) {                                                 \
       const uint next_idx = GET_INDEX(row, j, width, height);                  \
-      next_grid[next_idx].type = OIL_TYPE;                                   \
-      next_grid[next_idx].mass += mean_mass;                                   \
-      next_grid[next_idx].mass /= 2;                                           \
-      next_grid[next_idx].updated = false;                                     \
+      if (!IS_OIL(next_grid, next_idx) ||                                      \
+          MASS(next_grid, next_idx) != mean_mass)                              \
+        MARK_WRITTEN();                                                        \
+      TYPE(next_grid, next_idx) = OIL_TYPE;                                    \
+      MASS(next_grid, next_idx) += mean_mass;                                  \
+      MASS(next_grid, next_idx) /= 2;                                          \
+      UPDATED(next_grid, next_idx) = false;                                    \
     }                                                                          \
   }
 
@@ -463,12 +496,13 @@ STEP_IMPL(oil_step) {
         __assign_mean_mass_loop__(int j = col - 1, j >= left, j -= 1);
       }
 
-      next_grid[idx].mass = (remaining_mass + mean_mass) / 2;
-      remaining_mass = next_grid[idx].mass;
+      MASS(next_grid, idx) = (remaining_mass + mean_mass) / 2;
+      remaining_mass = MASS(next_grid, idx);
 
       if (remaining_mass <= min_mass) {
-        next_grid[idx].type = AIR_TYPE;
-        next_grid[idx].mass = AIR_MASS;
+        TYPE(next_grid, idx) = AIR_TYPE;
+        MASS(next_grid, idx) = AIR_MASS;
+        MARK_WRITTEN();
         return;
       }
 
@@ -479,30 +513,39 @@ STEP_IMPL(oil_step) {
 
   // upward flow
   if (top_valid
-          && IS_FLUID(next_grid[idx_top])
-          && !IS_WATER(next_grid[idx_top])
-          && !IS_SAND(next_grid[idx_top])) {
-    next_grid[idx_top].type = OIL_TYPE;
-    next_grid[idx_top].updated = false; // other cells updated by this
-
-    float flow = remaining_mass - fluid_get_stable_state(
-                                      remaining_mass + next_grid[idx_top].mass);
+          && IS_FLUID(next_grid, idx_top)
+          && !IS_WATER(next_grid, idx_top)
+          && !IS_SAND(next_grid, idx_top)) {
+    float flow =
+        remaining_mass -
+        fluid_get_stable_state(remaining_mass + MASS(next_grid, idx_top));
     flow *= flow > min_flow ? 0.5f : 1;
     flow = FCLAMP(flow, 0.0f, fmin(max_speed, remaining_mass));
 
+    // only a cell mass flows into turns liquid, else the surface would turn
+    // the cell above it into an empty liquid cell every step
+    if (flow > 0.0f) {
+      TYPE(next_grid, idx_top) = OIL_TYPE;
+      UPDATED(next_grid, idx_top) = false; // other cells updated by this
+      MARK_WRITTEN();
+    }
+
     remaining_mass -= flow;
-    next_grid[idx].mass -= flow;
-    next_grid[idx_top].mass += flow;
+    MASS(next_grid, idx) -= flow;
+    MASS(next_grid, idx_top) += flow;
 
     if (remaining_mass <= min_mass) {
-      next_grid[idx].type = AIR_TYPE;
-      next_grid[idx].mass = AIR_MASS;
+      TYPE(next_grid, idx) = AIR_TYPE;
+      MASS(next_grid, idx) = AIR_MASS;
+      MARK_WRITTEN();
       return;
     }
   }
 
   // set remaining mass to this cell
-  next_grid[idx].mass = remaining_mass;
+  MASS(next_grid, idx) = remaining_mass;
+  if (remaining_mass != MASS(grid, idx))
+    MARK_WRITTEN();
 
 }
 STEP_IMPL(jello_step) {}
@@ -518,42 +561,48 @@ STEP_IMPL(water_step) {
   const int horizontal_reach = 2;
   const int bot_reach = 2;
 
-  if (next_grid[idx].updated)
-    next_grid[idx].mass = grid[idx].mass;
+  if (UPDATED(next_grid, idx))
+    MASS(next_grid, idx) = MASS(grid, idx);
 
   // mark cell calculated
-  next_grid[idx].updated = false;
-  next_grid[idx].type = WATER_TYPE;
-  grid[idx].updated = true;
+  UPDATED(next_grid, idx) = false;
+  TYPE(next_grid, idx) = WATER_TYPE;
+  UPDATED(grid, idx) = true;
 
-  float remaining_mass = next_grid[idx].mass;
+  float remaining_mass = MASS(next_grid, idx);
   if (remaining_mass <= min_mass) {
-    next_grid[idx].type = AIR_TYPE;
-    next_grid[idx].mass = AIR_MASS;
+    TYPE(next_grid, idx) = AIR_TYPE;
+    MASS(next_grid, idx) = AIR_MASS;
+    MARK_WRITTEN();
     return;
   }
 
   // downward flow
   if (bot_valid
-          && IS_FLUID(grid[idx_bot])
-          && !IS_OIL(grid[idx_bot])
-          && !IS_SAND(next_grid[idx_bot])) {
-    next_grid[idx_bot].type = WATER_TYPE;
-    next_grid[idx_bot].updated = false;
-
+          && IS_FLUID(grid, idx_bot)
+          && !IS_OIL(grid, idx_bot)
+          && !IS_SAND(next_grid, idx_bot)) {
     float flow =
-        fluid_get_stable_state(remaining_mass + next_grid[idx_bot].mass) -
-        next_grid[idx_bot].mass;
+        fluid_get_stable_state(remaining_mass + MASS(next_grid, idx_bot)) -
+        MASS(next_grid, idx_bot);
     flow *= flow > min_flow ? dampen : 1.f;
     flow = FCLAMP(flow, 0, fmin(max_speed, remaining_mass));
 
+    // only a cell mass flows into turns liquid
+    if (flow > 0.0f) {
+      TYPE(next_grid, idx_bot) = WATER_TYPE;
+      UPDATED(next_grid, idx_bot) = false;
+      MARK_WRITTEN();
+    }
+
     remaining_mass -= flow;
-    next_grid[idx].mass -= flow;
-    next_grid[idx_bot].mass += flow;
+    MASS(next_grid, idx) -= flow;
+    MASS(next_grid, idx_bot) += flow;
 
     if (remaining_mass <= min_mass) {
-      next_grid[idx].type = AIR_TYPE;
-      next_grid[idx].mass = AIR_MASS;
+      TYPE(next_grid, idx) = AIR_TYPE;
+      MASS(next_grid, idx) = AIR_MASS;
+      MARK_WRITTEN();
       return;
     }
   }
@@ -564,43 +613,49 @@ STEP_IMPL(water_step) {
          left >= ((int)col - bot_reach) && left >= 0 && (row + down) < height;
          left -= 1, down += 1) {
       const uint next_idx = GET_INDEX(row + down, left, width, height);
-      if (!IS_FLUID(grid[next_idx])
-              || IS_OIL(grid[next_idx])
-              || IS_SAND(next_grid[next_idx]))
+      if (!IS_FLUID(grid, next_idx)
+              || IS_OIL(grid, next_idx)
+              || IS_SAND(next_grid, next_idx))
         break;
 
-      float flow = (next_grid[idx].mass - next_grid[next_idx].mass);
+      float flow = (MASS(next_grid, idx) - MASS(next_grid, next_idx));
       flow *= flow > min_flow ? dampen : 1.f;
-      flow = FCLAMP(flow, 0, next_grid[idx].mass);
+      flow = FCLAMP(flow, 0, MASS(next_grid, idx));
 
       remaining_mass -= flow;
 
       // if the block below is sand, 2% chance it'll get displaced to the
       // bottom right.
-      if (IS_SAND(next_grid[idx_bot]) && remaining_mass > 0.005f &&
-          get_rand(seed) % 100 < 3) {
+      if (IS_SAND(next_grid, idx_bot) && remaining_mass > 0.005f &&
+          get_rand(rng) % 100 < 3) {
+        MARK_WRITTEN();
+
         // new sand block to the bottom left.
-        next_grid[next_idx].type = SAND_TYPE;
-        next_grid[next_idx].mass = SAND_MASS;
-        next_grid[next_idx].updated = false;
+        TYPE(next_grid, next_idx) = SAND_TYPE;
+        MASS(next_grid, next_idx) = SAND_MASS;
+        UPDATED(next_grid, next_idx) = false;
 
         // new water block below.
-        next_grid[idx].mass -= flow;
-        next_grid[idx_bot].type = WATER_TYPE;
-        next_grid[idx_bot].mass = flow;
-        next_grid[idx_bot].updated = false;
+        MASS(next_grid, idx) -= flow;
+        TYPE(next_grid, idx_bot) = WATER_TYPE;
+        MASS(next_grid, idx_bot) = flow;
+        UPDATED(next_grid, idx_bot) = false;
         break;
       } else {
-        next_grid[next_idx].type = WATER_TYPE;
-        next_grid[next_idx].updated = false;
-        next_grid[next_idx].mass += flow;
-        next_grid[idx].mass -= flow;
+        if (flow > 0.0f || !IS_WATER(next_grid, next_idx))
+          MARK_WRITTEN();
+
+        TYPE(next_grid, next_idx) = WATER_TYPE;
+        UPDATED(next_grid, next_idx) = false;
+        MASS(next_grid, next_idx) += flow;
+        MASS(next_grid, idx) -= flow;
       }
     }
 
     if (remaining_mass <= min_mass) {
-      next_grid[idx].type = AIR_TYPE;
-      next_grid[idx].mass = AIR_MASS;
+      TYPE(next_grid, idx) = AIR_TYPE;
+      MASS(next_grid, idx) = AIR_MASS;
+      MARK_WRITTEN();
       return;
     }
 
@@ -610,44 +665,50 @@ STEP_IMPL(water_step) {
          (row + down) < height;
          right += 1, down += 1) {
       const uint next_idx = GET_INDEX(row + down, right, width, height);
-      if (!IS_FLUID(next_grid[next_idx])
-              || IS_OIL(grid[next_idx])
-              || IS_SAND(next_grid[next_idx]))
+      if (!IS_FLUID(next_grid, next_idx)
+              || IS_OIL(grid, next_idx)
+              || IS_SAND(next_grid, next_idx))
         break;
 
-      float flow = (next_grid[idx].mass - next_grid[next_idx].mass);
+      float flow = (MASS(next_grid, idx) - MASS(next_grid, next_idx));
       flow *= flow > min_flow ? dampen : 1.f;
-      flow = FCLAMP(flow, 0, next_grid[idx].mass);
+      flow = FCLAMP(flow, 0, MASS(next_grid, idx));
 
       remaining_mass -= flow;
 
       // if the block below is sand, 2% chance it'll get displaced to the
       // bottom left
-      if (IS_SAND(next_grid[idx_bot]) && remaining_mass > 0.005f &&
-          get_rand(seed) % 100 < 2) {
+      if (IS_SAND(next_grid, idx_bot) && remaining_mass > 0.005f &&
+          get_rand(rng) % 100 < 2) {
+        MARK_WRITTEN();
+
         // new sand block to the bottom left
-        next_grid[next_idx].type = SAND_TYPE;
-        next_grid[next_idx].mass = SAND_MASS;
-        next_grid[next_idx].updated = false;
+        TYPE(next_grid, next_idx) = SAND_TYPE;
+        MASS(next_grid, next_idx) = SAND_MASS;
+        UPDATED(next_grid, next_idx) = false;
 
         // new water block below
-        next_grid[idx].mass -= flow;
-        next_grid[idx_bot].type = WATER_TYPE;
-        next_grid[idx_bot].mass = flow;
-        next_grid[idx_bot].updated = false;
+        MASS(next_grid, idx) -= flow;
+        TYPE(next_grid, idx_bot) = WATER_TYPE;
+        MASS(next_grid, idx_bot) = flow;
+        UPDATED(next_grid, idx_bot) = false;
         break;
 
       } else {
-        next_grid[next_idx].type = WATER_TYPE;
-        next_grid[next_idx].updated = false;
-        next_grid[next_idx].mass += flow;
-        next_grid[idx].mass -= flow;
+        if (flow > 0.0f || !IS_WATER(next_grid, next_idx))
+          MARK_WRITTEN();
+
+        TYPE(next_grid, next_idx) = WATER_TYPE;
+        UPDATED(next_grid, next_idx) = false;
+        MASS(next_grid, next_idx) += flow;
+        MASS(next_grid, idx) -= flow;
       }
     }
 
     if (remaining_mass <= min_mass) {
-      next_grid[idx].type = AIR_TYPE;
-      next_grid[idx].mass = AIR_MASS;
+      TYPE(next_grid, idx) = AIR_TYPE;
+      MASS(next_grid, idx) = AIR_MASS;
+      MARK_WRITTEN();
       return;
     }
   }
@@ -662,36 +723,36 @@ STEP_IMPL(water_step) {
     // find left bound
     for (; left >= max((int)col - horizontal_reach, 0); left -= 1) {
       const uint idx = GET_INDEX(row, left, width, height);
-      if (!IS_FLUID(next_grid[idx])
-              || IS_OIL(next_grid[idx])
-              || IS_SAND(next_grid[idx]))
+      if (!IS_FLUID(next_grid, idx)
+              || IS_OIL(next_grid, idx)
+              || IS_SAND(next_grid, idx))
         break;
 
-      mass_left += next_grid[idx].mass;
+      mass_left += MASS(next_grid, idx);
     }
 
     // find right bound
     for (; right <= min(col + horizontal_reach, width - 1); right += 1) {
       const uint idx = GET_INDEX(row, right, width, height);
-      if (!IS_FLUID(next_grid[idx])
-              || IS_OIL(next_grid[idx])
-              || IS_SAND(next_grid[idx]))
+      if (!IS_FLUID(next_grid, idx)
+              || IS_OIL(next_grid, idx)
+              || IS_SAND(next_grid, idx))
         break;
 
-      mass_right += next_grid[idx].mass;
+      mass_right += MASS(next_grid, idx);
     }
 
     // correct
     left++;
     right--;
 
-    float mean_mass = (mass_left + mass_right + next_grid[idx].mass);
+    float mean_mass = (mass_left + mass_right + MASS(next_grid, idx));
     mean_mass /= (right - left + 1);
 
 #ifdef DEBUG
     if (mean_mass < 0.0f) {
       printf("%f-%f-%f-%f\n", mean_mass, mass_left, mass_right,
-             next_grid[idx].mass);
+             MASS(next_grid, idx));
 
     } else {
 #endif
@@ -700,10 +761,13 @@ STEP_IMPL(water_step) {
   {                                                                            \
     for (init; cond; update) {                                                 \
       const uint next_idx = GET_INDEX(row, j, width, height);                  \
-      next_grid[next_idx].type = WATER_TYPE;                                   \
-      next_grid[next_idx].mass += mean_mass;                                   \
-      next_grid[next_idx].mass /= 2;                                           \
-      next_grid[next_idx].updated = false;                                     \
+      if (!IS_WATER(next_grid, next_idx) ||                                    \
+          MASS(next_grid, next_idx) != mean_mass)                              \
+        MARK_WRITTEN();                                                        \
+      TYPE(next_grid, next_idx) = WATER_TYPE;                                  \
+      MASS(next_grid, next_idx) += mean_mass;                                  \
+      MASS(next_grid, next_idx) /= 2;                                          \
+      UPDATED(next_grid, next_idx) = false;                                    \
     }                                                                          \
   }
 
@@ -716,12 +780,13 @@ STEP_IMPL(water_step) {
         __assign_mean_mass_loop__(int j = col - 1, j >= left, j -= 1);
       }
 
-      next_grid[idx].mass = (remaining_mass + mean_mass) / 2;
-      remaining_mass = next_grid[idx].mass;
+      MASS(next_grid, idx) = (remaining_mass + mean_mass) / 2;
+      remaining_mass = MASS(next_grid, idx);
 
       if (remaining_mass <= min_mass) {
-        next_grid[idx].type = AIR_TYPE;
-        next_grid[idx].mass = AIR_MASS;
+        TYPE(next_grid, idx) = AIR_TYPE;
+        MASS(next_grid, idx) = AIR_MASS;
+        MARK_WRITTEN();
         return;
       }
 
@@ -732,30 +797,39 @@ STEP_IMPL(water_step) {
 
   // upward flow
   if (top_valid
-          && IS_FLUID(next_grid[idx_top])
-          && !IS_OIL(next_grid[idx_top])
-          && !IS_SAND(next_grid[idx_top])) {
-    next_grid[idx_top].type = WATER_TYPE;
-    next_grid[idx_top].updated = false; // other cells updated by this
-
-    float flow = remaining_mass - fluid_get_stable_state(
-                                      remaining_mass + next_grid[idx_top].mass);
+          && IS_FLUID(next_grid, idx_top)
+          && !IS_OIL(next_grid, idx_top)
+          && !IS_SAND(next_grid, idx_top)) {
+    float flow =
+        remaining_mass -
+        fluid_get_stable_state(remaining_mass + MASS(next_grid, idx_top));
     flow *= flow > min_flow ? 0.5f : 1;
     flow = FCLAMP(flow, 0.0f, fmin(max_speed, remaining_mass));
 
+    // only a cell mass flows into turns liquid, else the surface would turn
+    // the cell above it into an empty liquid cell every step
+    if (flow > 0.0f) {
+      TYPE(next_grid, idx_top) = WATER_TYPE;
+      UPDATED(next_grid, idx_top) = false; // other cells updated by this
+      MARK_WRITTEN();
+    }
+
     remaining_mass -= flow;
-    next_grid[idx].mass -= flow;
-    next_grid[idx_top].mass += flow;
+    MASS(next_grid, idx) -= flow;
+    MASS(next_grid, idx_top) += flow;
 
     if (remaining_mass <= min_mass) {
-      next_grid[idx].type = AIR_TYPE;
-      next_grid[idx].mass = AIR_MASS;
+      TYPE(next_grid, idx) = AIR_TYPE;
+      MASS(next_grid, idx) = AIR_MASS;
+      MARK_WRITTEN();
       return;
     }
   }
 
   // set remaining mass to this cell
-  next_grid[idx].mass = remaining_mass;
+  MASS(next_grid, idx) = remaining_mass;
+  if (remaining_mass != MASS(grid, idx))
+    MARK_WRITTEN();
 }
 
 //  sand
@@ -764,75 +838,77 @@ STEP_IMPL(sand_step) {
 
 #define __move_sand__(idx_next)                                                \
   {                                                                            \
-    next_grid[idx].type = AIR_TYPE;                                            \
-    next_grid[idx_next].type = SAND_TYPE;                                      \
-    next_grid[idx].mass = AIR_MASS;                                            \
-    next_grid[idx_next].mass = SAND_MASS;                                      \
-    next_grid[idx].velocity = V_STATIONARY;                                    \
-    next_grid[idx_next].velocity = V_STATIONARY;                               \
-    next_grid[idx].updated = false;                                            \
-    next_grid[idx_next].updated = false;                                       \
-    grid[idx].updated = true;                                                  \
-    grid[idx_next].updated = true;                                             \
+    TYPE(next_grid, idx) = AIR_TYPE;                                           \
+    TYPE(next_grid, idx_next) = SAND_TYPE;                                     \
+    MASS(next_grid, idx) = AIR_MASS;                                           \
+    MASS(next_grid, idx_next) = SAND_MASS;                                     \
+    VELOCITY(next_grid, idx) = V_STATIONARY;                                   \
+    VELOCITY(next_grid, idx_next) = V_STATIONARY;                              \
+    UPDATED(next_grid, idx) = false;                                           \
+    UPDATED(next_grid, idx_next) = false;                                      \
+    UPDATED(grid, idx) = true;                                                 \
+    UPDATED(grid, idx_next) = true;                                            \
+    MARK_WRITTEN();                                                            \
   }
 
   if (!bot_valid)
     return;
 
   // move down if possible
-  if (IS_FLUID(grid[idx_bot])) {
+  if (IS_FLUID(grid, idx_bot)) {
     int replacement_type = AIR_TYPE;
     float replacement_mass = AIR_MASS;
 
     // 45% chance water will be pushed above by sand
     // 50% change water will eat sand away
-    if (get_rand(seed) % 100 < 45) {
-      replacement_mass = next_grid[idx_bot].mass;
-      replacement_type = next_grid[idx_bot].type;
+    if (get_rand(rng) % 100 < 45) {
+      replacement_mass = MASS(next_grid, idx_bot);
+      replacement_type = TYPE(next_grid, idx_bot);
     }
 
-    next_grid[idx].type = replacement_type;
-    next_grid[idx_bot].type = SAND_TYPE;
+    TYPE(next_grid, idx) = replacement_type;
+    TYPE(next_grid, idx_bot) = SAND_TYPE;
 
-    next_grid[idx].mass = replacement_mass;
-    next_grid[idx_bot].mass = SAND_MASS;
+    MASS(next_grid, idx) = replacement_mass;
+    MASS(next_grid, idx_bot) = SAND_MASS;
 
-    next_grid[idx].velocity = V_STATIONARY;
-    next_grid[idx_bot].velocity = V_STATIONARY;
+    VELOCITY(next_grid, idx) = V_STATIONARY;
+    VELOCITY(next_grid, idx_bot) = V_STATIONARY;
 
-    next_grid[idx].updated = false;
-    next_grid[idx_bot].updated = false;
+    UPDATED(next_grid, idx) = false;
+    UPDATED(next_grid, idx_bot) = false;
 
     // mark this cell updated
-    grid[idx].updated = true;
-    grid[idx_bot].updated = true;
+    UPDATED(grid, idx) = true;
+    UPDATED(grid, idx_bot) = true;
+    MARK_WRITTEN();
   }
 
   // move down left/right if possible with uniform probability
   // TODO(vir): improve random number generation for this case
-  else if (get_rand(seed) % 2 == 0) {
+  else if (get_rand(rng) % 2 == 0) {
 
     // prefer left
-    if (left_valid && IS_FLUID(grid[idx_bot_left]) &&
-        !grid[idx_bot_left].updated) {
+    if (left_valid && IS_FLUID(grid, idx_bot_left) &&
+        !UPDATED(grid, idx_bot_left)) {
       __move_sand__(idx_bot_left);
     }
 
-    else if (right_valid && IS_FLUID(grid[idx_bot_right]) &&
-             !grid[idx_bot_right].updated) {
+    else if (right_valid && IS_FLUID(grid, idx_bot_right) &&
+             !UPDATED(grid, idx_bot_right)) {
       __move_sand__(idx_bot_right);
     }
 
   } else {
 
     // prefer right
-    if (right_valid && IS_FLUID(grid[idx_bot_right]) &&
-        !grid[idx_bot_right].updated) {
+    if (right_valid && IS_FLUID(grid, idx_bot_right) &&
+        !UPDATED(grid, idx_bot_right)) {
       __move_sand__(idx_bot_right);
     }
 
-    else if (left_valid && IS_FLUID(grid[idx_bot_left]) &&
-             !grid[idx_bot_left].updated) {
+    else if (left_valid && IS_FLUID(grid, idx_bot_left) &&
+             !UPDATED(grid, idx_bot_left)) {
       __move_sand__(idx_bot_left);
     }
   }
@@ -844,14 +920,15 @@ STEP_IMPL(sand_step) {
 STEP_IMPL(water_oil_step) {
   GEN_STEP_IMPL_HEADER();
 
-  if (bot_valid && IS_WATER(grid[idx]) && IS_OIL(grid[idx_bot])) {
-    float water_mass = grid[idx].mass;
+  if (bot_valid && IS_WATER(grid, idx) && IS_OIL(grid, idx_bot)) {
+    float water_mass = MASS(grid, idx);
     // Oil comes up.
-    next_grid[idx].type = OIL_TYPE;
-    next_grid[idx].mass = grid[idx_bot].mass;
+    TYPE(next_grid, idx) = OIL_TYPE;
+    MASS(next_grid, idx) = MASS(grid, idx_bot);
     // Water goes down.
-    next_grid[idx_bot].type = WATER_TYPE;
-    next_grid[idx_bot].mass = water_mass;
+    TYPE(next_grid, idx_bot) = WATER_TYPE;
+    MASS(next_grid, idx_bot) = water_mass;
+    MARK_WRITTEN();
   }
 
   return;
@@ -7,9 +7,10 @@
 #include "cell.cl"
 
 // {{{ initialize kernel
-__kernel void initialize(__global ulong *seeds, __global grid_t *grid,
-                         __global grid_t *next_grid, const uint2 dims) {
+__kernel void initialize(const ulong key, grid_buffer_t grid_buffer,
+                         grid_buffer_t next_grid_buffer, const uint2 dims) {
   GEN_LOC_VARS();
+  GEN_GRID_REFS();
   const uint size = get_global_size(0); // full grid size (rows)
 
   const uint width = dims[0];
@@ -18,72 +19,80 @@ __kernel void initialize(__global ulong *seeds, __global grid_t *grid,
   const unsigned int idx = GET_INDEX(row, col, width, height);
   // printf("%d-%d-%d\n", row, col, idx);
 
-  grid[idx].type = AIR_TYPE;
-  next_grid[idx].type = AIR_TYPE;
+  TYPE(grid, idx) = AIR_TYPE;
+  TYPE(next_grid, idx) = AIR_TYPE;
 
-  grid[idx].mass = AIR_MASS;
-  next_grid[idx].mass = AIR_MASS;
+  MASS(grid, idx) = AIR_MASS;
+  MASS(next_grid, idx) = AIR_MASS;
 
-  grid[idx].velocity = V_STATIONARY;
-  next_grid[idx].velocity = V_STATIONARY;
+  VELOCITY(grid, idx) = V_STATIONARY;
+  VELOCITY(next_grid, idx) = V_STATIONARY;
 
-  grid[idx].updated = false;
-  next_grid[idx].updated = false;
+  UPDATED(grid, idx) = false;
+  UPDATED(next_grid, idx) = false;
 
   // draw box with water
   // if (abs(row - (height / 2) - 5) < 5 &&
   //     abs(col - width / 4 - 5) < width / 2 + 5) {
-  //   grid[idx].type = STONE_TYPE;
-  //   next_grid[idx].type = STONE_TYPE;
+  //   TYPE(grid, idx) = STONE_TYPE;
+  //   TYPE(next_grid, idx) = STONE_TYPE;
 
-  //   grid[idx].mass = STONE_MASS;
-  //   next_grid[idx].mass = STONE_MASS;
+  //   MASS(grid, idx) = STONE_MASS;
+  //   MASS(next_grid, idx) = STONE_MASS;
   // }
 
   // else if ((abs(col - (width * 1 / 4) - 5) < 5 ||
   //           abs(col - (width * 3 / 4) - 5) < 5) &&
   //          abs(row - height / 2 + 80) < 100) {
-  //   grid[idx].type = STONE_TYPE;
-  //   next_grid[idx].type = STONE_TYPE;
+  //   TYPE(grid, idx) = STONE_TYPE;
+  //   TYPE(next_grid, idx) = STONE_TYPE;
 
-  //   grid[idx].mass = STONE_MASS;
-  //   next_grid[idx].mass = STONE_MASS;
+  //   MASS(grid, idx) = STONE_MASS;
+  //   MASS(next_grid, idx) = STONE_MASS;
   // }
 
-  // else if (get_rand(&seeds[idx]) % 2 == 0) {
-  //   grid[idx].type = WATER_TYPE;
-  //   next_grid[idx].type = WATER_TYPE;
+  // else if (get_rand(&rng) % 2 == 0) {
+  //   TYPE(grid, idx) = WATER_TYPE;
+  //   TYPE(next_grid, idx) = WATER_TYPE;
 
-  //   grid[idx].mass = WATER_MASS;
-  //   next_grid[idx].mass = WATER_MASS;
+  //   MASS(grid, idx) = WATER_MASS;
+  //   MASS(next_grid, idx) = WATER_MASS;
   // }
 }
 // }}}
 
 // {{{ random init kernel
-__kernel void random_init(__global ulong *seeds, __global grid_t *grid,
-                          const __global grid_t *next_grid, const uint2 dims) {
+__kernel void random_init(const ulong key, grid_buffer_t grid_buffer,
+                          grid_buffer_t next_grid_buffer, const uint2 dims) {
   GEN_LOC_VARS();
+  GEN_GRID_REFS();
 
   const uint width = dims[0];
   const uint height = dims[1];
 
   const uint idx = GET_INDEX(row, col, width, height);
-  const uint rand = get_rand(&seeds[idx]);
 
+  GEN_RNG();
+  const uint rand = get_rand(&rng);
+
+  // both grids, a step expects them to start out equal
   if (rand % 20) {
-    grid[idx].type = SAND_TYPE;
-    grid[idx].mass = SAND_TYPE;
-    grid[idx].velocity = V_STATIONARY;
-    grid[idx].updated = false;
+    TYPE(grid, idx) = SAND_TYPE;
+    MASS(grid, idx) = SAND_TYPE;
+    VELOCITY(grid, idx) = V_STATIONARY;
+    UPDATED(grid, idx) = false;
+    COPY_CELL(next_grid, grid, idx);
   }
 }
 // }}}
 
 //  {{{ simulate kernel
-__kernel void simulate(__global ulong *seeds, __global grid_t *grid,
-                       __global grid_t *next_grid, const uint2 dims) {
+__kernel void simulate(const ulong key, grid_buffer_t grid_buffer,
+                       grid_buffer_t next_grid_buffer, const uint2 dims,
+                       __global uint *tile_steps, const uint step) {
   GEN_LOC_VARS();
+  GEN_GRID_REFS();
+  GEN_RNG();
   const uint2 loc = {row, col};
 
   const uint width = dims[0];
@@ -93,7 +102,8 @@ __kernel void simulate(__global ulong *seeds, __global grid_t *grid,
   GEN_BOUNDS_VALID(row, col, width, height);
   GEN_NEIGHBOUR_INDICES(row, col, width, height);
 
-  const uint type = (uint)grid[idx].type; // scale up from std::uint8_t
+  const uint type = (uint)TYPE(grid, idx); // scale up from std::uint8_t
+  bool wrote = false;
 
   switch (type) {
   case SMOKE_TYPE:
@@ -132,14 +142,22 @@ __kernel void simulate(__global ulong *seeds, __global grid_t *grid,
   default:
     break;
   }
+
+  // stamp this tile if its cell changed next_grid, see carry_forward. cells
+  // at rest leave their tile alone
+  if (wrote)
+    tile_steps[GET_TILE_INDEX()] = step;
 }
 // }}} simulate kernel
 
 // {{{ fluid pass
-__kernel void fluid_pass(__global ulong *seeds, __global grid_t *grid,
-                         __global grid_t *next_grid, const uint2 dims) {
+__kernel void fluid_pass(const ulong key, grid_buffer_t grid_buffer,
+                         grid_buffer_t next_grid_buffer, const uint2 dims,
+                         __global uint *tile_steps, const uint step) {
   // If water is above oil, swap.
   GEN_LOC_VARS();
+  GEN_GRID_REFS();
+  GEN_RNG();
   const uint2 loc = {row, col};
 
   const uint width = dims[0];
@@ -149,65 +167,158 @@ __kernel void fluid_pass(__global ulong *seeds, __global grid_t *grid,
   GEN_BOUNDS_VALID(row, col, width, height);
   GEN_NEIGHBOUR_INDICES(row, col, width, height);
 
+  bool wrote = false;
   INVOKE_IMPL(water_oil_step);
+
+  // the step stamps like simulate does, see carry_forward
+  if (wrote)
+    tile_steps[GET_TILE_INDEX()] = step;
+}
+// }}}
+
+// {{{ carry forward kernel
+// bring the buffer the last step read from up to date with the one it wrote,
+// so the next step starts with both equal without copying the whole grid.
+// a step writes at most 2 cells away from a cell that stamped its tile, so
+// only tiles next to a tile stamped with that step can differ
+__kernel void carry_forward(grid_buffer_t grid_buffer,
+                            grid_buffer_t next_grid_buffer, const uint2 dims,
+                            __global const uint *tile_steps, const uint step) {
+  GEN_LOC_VARS();
+  GEN_GRID_REFS();
+
+  const uint width = dims[0];
+  const uint height = dims[1];
+
+  const int tile_col = get_group_id(0);
+  const int tile_row = get_group_id(1);
+  const int tiles_wide = get_num_groups(0);
+  const int tiles_high = get_num_groups(1);
+
+  bool touched = false;
+  for (int r = max(tile_row - 1, 0); r <= min(tile_row + 1, tiles_high - 1);
+       r += 1) {
+    for (int c = max(tile_col - 1, 0); c <= min(tile_col + 1, tiles_wide - 1);
+         c += 1) {
+      touched = touched || tile_steps[r * tiles_wide + c] == step;
+    }
+  }
+
+  if (touched) {
+    const uint idx = GET_INDEX(row, col, width, height);
+    COPY_CELL(next_grid, grid, idx);
+  }
 }
 // }}}
 
 // {{{ render texture kernel
-__kernel void render_texture(__global ulong *seeds,
+__kernel void render_texture(const ulong key,
                              __write_only image2d_t texture,
-                             __global const grid_t *grid,
-                             __global const grid_t *next_grid, const uint2 dims,
+                             grid_buffer_t grid_buffer, const uint2 dims,
                              const uint cell_size) {
   GEN_LOC_VARS();
+  const grid_ref_t grid = GRID_REF(grid_buffer, dims);
 
   const uint width = dims[0];
   const uint height = dims[1];
 
   const uint idx = GET_INDEX(row, col, width, height);
-  const uint type = (int)grid[idx].type; // scale up from std::uint8_t
+  const uint type = (int)TYPE(grid, idx); // scale up from std::uint8_t
 
   // write texture
   // attributes go here
   const float4 out_color = {
-      type, next_grid[idx].mass,
-      0, // grid[idx].velocity.x,
-      0, // grid[idx].velocity.y,
+      type, MASS(grid, idx),
+      0, // VELOCITY(grid, idx).x,
+      0, // VELOCITY(grid, idx).y,
   };
 
   const int2 out_coord = {width - col - 1, height - row - 1};
   write_imagef(texture, out_coord, out_color);
 }
+
+// render_texture into a buffer laid out like the texture (GL_RG32F), for
+// devices without gl sharing
+__kernel void render_texels(__global float2 *texels,
+                            grid_buffer_t grid_buffer, const uint2 dims) {
+  GEN_LOC_VARS();
+  const grid_ref_t grid = GRID_REF(grid_buffer, dims);
+
+  const uint width = dims[0];
+  const uint height = dims[1];
+
+  const uint idx = GET_INDEX(row, col, width, height);
+  const uint type = (int)TYPE(grid, idx); // scale up from std::uint8_t
+
+  const uint out_idx = (height - row - 1) * width + (width - col - 1);
+  texels[out_idx] = (float2){(float)type, MASS(grid, idx)};
+}
 // }}}
 
 // {{{ spawn cells kernel
-__kernel void spawn_cells(__global ulong *seeds, __global grid_t *grid,
-                          __global grid_t *next_grid, const uint2 center,
+inline void spawn_cell(grid_ref_t grid, grid_ref_t next_grid, const uint idx,
+                       const uint target, rng_t *rng) {
+  TYPE(next_grid, idx) = target;
+  TYPE(grid, idx) = target;
+
+  const float mass = get_mass(target, rng);
+  MASS(next_grid, idx) = mass;
+  MASS(grid, idx) = mass;
+
+  VELOCITY(next_grid, idx) = V_STATIONARY;
+  VELOCITY(grid, idx) = V_STATIONARY;
+
+  UPDATED(next_grid, idx) = false;
+  UPDATED(grid, idx) = false;
+}
+
+__kernel void spawn_cells(const ulong key, grid_buffer_t grid_buffer,
+                          grid_buffer_t next_grid_buffer, const uint2 center,
                           const uint paint_radius, const uint target,
                           const uint2 dims, const uint cell_size) {
   GEN_LOC_VARS();
+  GEN_GRID_REFS();
 
   const uint width = dims.x;
   const uint height = dims.y;
   const uint screen_col = width - col - 1;
 
+  // launched over the disc's bounding box, see DeviceGrid::spawn_cells
   const uint idx = GET_INDEX(row, screen_col, width, height);
-  const float d =
-      sqrt(pow(col - (float)center.x, 2) + pow(row - (float)center.y, 2));
+  const int dx = (int)col - (int)center.x;
+  const int dy = (int)row - (int)center.y;
+  const int r = (int)paint_radius;
+
+  if (dx * dx + dy * dy <= r * r &&
+      (VACANT(grid, idx) || (target == AIR_TYPE))) {
+    GEN_RNG();
+    spawn_cell(grid, next_grid, idx, target, &rng);
+  }
+}
+
+// one work item per cell of the mask's box, origin is its top left cell
+__kernel void paint_cells(const ulong key, grid_buffer_t grid_buffer,
+                          grid_buffer_t next_grid_buffer,
+                          __global const uchar *mask, const uint2 origin,
+                          const uint target, const uint2 dims) {
+  const uint mask_col = get_global_id(0);
+  const uint mask_row = get_global_id(1);
+  if (!mask[mask_row * get_global_size(0) + mask_col])
+    return;
 
-  if (d <= paint_radius && (VACANT(grid[idx]) || (target == AIR_TYPE))) {
-    next_grid[idx].type = target;
-    grid[idx].type = target;
+  const uint col = origin.x + mask_col;
+  const uint row = origin.y + mask_row;
 
-    const float mass = get_mass(target, &seeds[idx]);
-    next_grid[idx].mass = mass;
-    grid[idx].mass = mass;
+  const uint width = dims.x;
+  const uint height = dims.y;
+  const uint screen_col = width - col - 1;
 
-    next_grid[idx].velocity = V_STATIONARY;
-    grid[idx].velocity = V_STATIONARY;
+  GEN_GRID_REFS();
 
-    next_grid[idx].updated = false;
-    grid[idx].updated = false;
+  const uint idx = GET_INDEX(row, screen_col, width, height);
+  if (VACANT(grid, idx) || (target == AIR_TYPE)) {
+    GEN_RNG();
+    spawn_cell(grid, next_grid, idx, target, &rng);
   }
 }
 // }}}
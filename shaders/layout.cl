@@ -0,0 +1,51 @@
+// vim: ft=cpp :
+
+#ifndef SIMULAKE_LAYOUT_CL
+#define SIMULAKE_LAYOUT_CL
+
+/*
+ * NOTE(vir): shared by the opencl kernels (base.cl) and the device grid
+ * (src/simulake/device_grid.cpp), keep to the common subset of C++ and
+ * OpenCL C.
+ *
+ * cells are stored row major in either layout, see GET_INDEX. the planes
+ * layout keeps one array per cell attribute in a single buffer, each plane
+ * starting on a GRID_PLANE_ALIGN byte boundary:
+ *
+ *   [ type : char | mass : float | velocity : float2 | updated : uchar ]
+ */
+
+#ifdef __OPENCL_VERSION__
+#define LAYOUT_INLINE inline
+typedef uint layout_u32_t;
+#else
+#define LAYOUT_INLINE constexpr inline
+typedef std::uint32_t layout_u32_t;
+#endif
+
+#define GRID_PLANE_ALIGN 256
+
+// bytes taken by a plane of given size, rounded up to the alignment
+LAYOUT_INLINE layout_u32_t grid_plane_size(const layout_u32_t bytes) {
+  return (bytes + GRID_PLANE_ALIGN - 1) / GRID_PLANE_ALIGN * GRID_PLANE_ALIGN;
+}
+
+// byte offsets of the planes of a grid of num_cells cells
+LAYOUT_INLINE layout_u32_t grid_mass_offset(const layout_u32_t num_cells) {
+  return grid_plane_size(num_cells);
+}
+
+LAYOUT_INLINE layout_u32_t grid_velocity_offset(const layout_u32_t num_cells) {
+  return grid_mass_offset(num_cells) + grid_plane_size(num_cells * 4);
+}
+
+LAYOUT_INLINE layout_u32_t grid_updated_offset(const layout_u32_t num_cells) {
+  return grid_velocity_offset(num_cells) + grid_plane_size(num_cells * 8);
+}
+
+// size of the whole buffer
+LAYOUT_INLINE layout_u32_t grid_planes_size(const layout_u32_t num_cells) {
+  return grid_updated_offset(num_cells) + grid_plane_size(num_cells);
+}
+
+#endif
@@ -0,0 +1,70 @@
+// vim: ft=cpp :
+
+#ifndef SIMULAKE_RANDOM_CL
+#define SIMULAKE_RANDOM_CL
+
+/*
+ * NOTE(vir): shared by the opencl kernels (base.cl) and the cpu grid
+ * (src/simulake/random.hpp), keep to the common subset of C++ and OpenCL C.
+ *
+ * counter based random numbers using squares (Widynski, 2020). every draw
+ * is a pure function of (key, counter): the key is derived from (seed,
+ * frame) and the counter from (x, y, draw), so any cell can draw random
+ * numbers from any thread without shared state, reproducibly.
+ *
+ * counter layout: [ y : 24 | x : 24 | draw : 16 ]
+ */
+
+#ifdef __OPENCL_VERSION__
+#define RNG_INLINE inline
+#define RNG_U64(c) c##UL
+typedef ulong rng_u64_t;
+typedef uint rng_u32_t;
+#else
+#define RNG_INLINE constexpr inline
+#define RNG_U64(c) UINT64_C(c)
+typedef std::uint64_t rng_u64_t;
+typedef std::uint32_t rng_u32_t;
+#endif
+
+#define RNG_DRAW_BITS 16
+
+// splitmix64 finalizer, spreads seeds into well mixed keys
+RNG_INLINE rng_u64_t rng_mix64(rng_u64_t z) {
+  z = (z ^ (z >> 30)) * RNG_U64(0xBF58476D1CE4E5B9);
+  z = (z ^ (z >> 27)) * RNG_U64(0x94D049BB133111EB);
+  return z ^ (z >> 31);
+}
+
+// key for all draws of a given frame, squares needs an odd key
+RNG_INLINE rng_u64_t rng_frame_key(rng_u64_t seed, rng_u32_t frame) {
+  return rng_mix64(seed + (rng_u64_t)frame * RNG_U64(0x9E3779B97F4A7C15)) |
+         RNG_U64(1);
+}
+
+// first counter of the cell at (x, y), leaves room for 2^16 draws per cell
+RNG_INLINE rng_u64_t rng_cell_counter(rng_u32_t x, rng_u32_t y) {
+  return (((rng_u64_t)y << 24) | (rng_u64_t)(x & 0xFFFFFF)) << RNG_DRAW_BITS;
+}
+
+// squares32, 4 rounds of middle square weyl sequence
+RNG_INLINE rng_u32_t rng_squares32(rng_u64_t counter, rng_u64_t key) {
+  rng_u64_t x = counter * key;
+  const rng_u64_t y = x;
+  const rng_u64_t z = y + key;
+
+  x = x * x + y;
+  x = (x >> 32) | (x << 32);
+  x = x * x + z;
+  x = (x >> 32) | (x << 32);
+  x = x * x + y;
+  x = (x >> 32) | (x << 32);
+  return (rng_u32_t)((x * x + z) >> 32);
+}
+
+// uniform float in [0, 1) from the top 24 bits
+RNG_INLINE float rng_to_float(rng_u32_t r) {
+  return (float)(r >> 8) * (1.0f / 16777216.0f);
+}
+
+#endif
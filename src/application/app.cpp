@@ -1,3 +1,5 @@
+#include <thread>
+
 #include "app.hpp"
 #include "loader.hpp"
 
@@ -6,8 +8,8 @@ namespace simulake {
 App::App(std::uint32_t width, std::uint32_t height, std::uint32_t cell_size,
          const std::string_view title)
     : window(width * cell_size, height * cell_size, title),
-      renderer(width, height, cell_size), device_grid(width, height, cell_size),
-      grid(width, height), state(AppState::get_instance()) {
+      renderer(width, height, cell_size), grid(width, height), brush(width, height),
+      state(AppState::get_instance()) {
 
   state.set_renderer(&renderer);
   state.set_window(&window);
@@ -23,28 +25,80 @@ App::App(std::uint32_t width, std::uint32_t height, std::uint32_t cell_size,
   state.set_window_size(std::get<0>(size), std::get<1>(size));
 }
 
-void App::step_sim(bool paused, GridBase *sim_grid) noexcept {
-  const auto target_type = state.get_target_type();
+App::input_t App::poll_input() const noexcept {
+  return {.paused = state.is_paused()};
+}
+
+bool App::step_sim(GridBase *sim_grid, const std::uint32_t steps) noexcept {
+  brush_event_t event;
+  while (state.pop_brush_event(event))
+    brush.add(event);
 
-  if (state.is_mouse_pressed() and target_type != CellType::NONE) {
-    std::uint32_t x = static_cast<std::uint32_t>(
-        grid.get_width() *
-        (state.get_prev_mouse_x() / state.get_window_width()));
-    std::uint32_t y = static_cast<std::uint32_t>(
-        grid.get_height() *
-        (state.get_prev_mouse_y() / state.get_window_height()));
+  /* NOTE(vir): a full queue may drop the release, the callbacks clear the
+   * pressed flag only after queueing it so no queued sample is cut off */
+  if (!state.is_mouse_pressed())
+    brush.release();
 
-    sim_grid->spawn_cells({x, y}, state.get_spawn_radius(), target_type);
-  }
+  const bool painted = brush.paint(sim_grid, std::chrono::steady_clock::now());
+
+  for (std::uint32_t step = 0; step < steps; step += 1)
+    sim_grid->simulate(timestep.get_delta_time());
+
+  return painted or steps > 0;
+}
 
-  if (!paused)
-    sim_grid->simulate(state.get_delta_time());
+void App::run_sim(std::stop_token stop, GridBase *sim_grid) noexcept {
+  using clock = std::chrono::steady_clock;
+  auto prev = clock::now();
+
+  while (!stop.stop_requested()) {
+    input_t curr_input;
+    {
+      const std::scoped_lock lock(input_mutex);
+      curr_input = input;
+    }
+
+    const auto now = clock::now();
+    const float elapsed = std::chrono::duration<float>(now - prev).count();
+    prev = now;
+
+    std::uint32_t steps = 0;
+    if (curr_input.paused)
+      timestep.reset();
+    else
+      steps = timestep.advance(elapsed);
+
+    /* publish only frames that changed */
+    if (step_sim(sim_grid, steps)) {
+      auto &frame = frames.back();
+      sim_grid->serialize_into(frame.grid);
+      frames.publish();
+    }
+
+    /* sleep until the next step is due, a slow step is caught up by the
+     * next advance instead */
+    std::this_thread::sleep_until(
+        now + std::chrono::duration_cast<clock::duration>(
+                  std::chrono::duration<float>(timestep.get_time_to_step())));
+  }
 }
 
-void App::run(const bool gpu_mode, GridBase::serialized_grid_t *data) noexcept {
+void App::run(const bool use_device, GridBase::serialized_grid_t *data) noexcept {
+
+  /* NOTE(vir): the device grid is only built when asked for, so hosts
+   * without a usable opencl device still run the cpu grid */
+  if (use_device and device_grid == nullptr) {
+    device_grid = DeviceGrid::create(grid.get_width(), grid.get_height(),
+                                     state.get_cell_size(), device_options,
+                                     device_layout);
+
+    if (device_grid == nullptr)
+      std::cerr << "falling back to the cpu grid" << std::endl;
+  }
 
   /* init grid and simulation update function */
-  GridBase *sim_grid = gpu_mode ? static_cast<GridBase *>(&device_grid)
+  const bool gpu_mode = use_device and device_grid != nullptr;
+  GridBase *sim_grid = gpu_mode ? static_cast<GridBase *>(device_grid.get())
                                 : static_cast<GridBase *>(&grid);
   state.set_grid(sim_grid);
   if (data != nullptr) {
@@ -56,6 +110,15 @@ void App::run(const bool gpu_mode, GridBase::serialized_grid_t *data) noexcept {
 
   renderer.submit_grid(sim_grid);
 
+  /* NOTE(vir): the cpu grid steps on its own thread, so rendering never
+   * waits for a step and stepping never waits for vsync. the device grid
+   * writes the render texture through cl/gl sharing, it steps in line */
+  std::jthread sim_thread;
+  if (!gpu_mode) {
+    sim_thread = std::jthread(
+        [this, sim_grid](std::stop_token stop) { run_sim(stop, sim_grid); });
+  }
+
 #if ENABLE_PROFILING
   std::uint64_t frame_count = 0;
   std::chrono::time_point start = std::chrono::high_resolution_clock::now();
@@ -72,21 +135,54 @@ void App::run(const bool gpu_mode, GridBase::serialized_grid_t *data) noexcept {
     state.set_time(window.get_time());
     window.poll_events();
 
-    /* step the simulation */
-    step_sim(state.is_paused(), sim_grid);
-    if (!gpu_mode)
-      renderer.submit_grid(sim_grid);
+    /* step the simulation, or hand input to it and take its latest frame */
+    if (gpu_mode) {
+      const input_t curr_input = poll_input();
+
+      std::uint32_t steps = 0;
+      if (curr_input.paused)
+        timestep.reset();
+      else
+        steps = timestep.advance(state.get_delta_time());
+
+      step_sim(sim_grid, steps);
+    } else {
+      {
+        const std::scoped_lock lock(input_mutex);
+        input = poll_input();
+      }
+
+      if (frames.update())
+        renderer.submit_grid(frames.front().grid);
+    }
+
+    /* NOTE(vir): the cpu grid has no frame to store before its first
+     * published step */
+    if (state.take_store_request()) {
+      if (!gpu_mode and frames.front().grid.buffer.empty()) {
+        std::cerr << "nothing to store yet" << std::endl;
+      } else {
+        Loader::store_grid(gpu_mode ? sim_grid->serialize()
+                                    : frames.front().grid);
+        std::cout << "stored grid to disk" << std::endl;
+      }
+    }
 
     /* push frame */
     renderer.render();
     window.swap_buffers();
   }
 
+  /* stop and join the simulation thread */
+  sim_thread = {};
+
 #if ENABLE_PROFILING
   const auto delta = (std::chrono::high_resolution_clock::now() - start);
   const auto duration_s =
       std::chrono::duration_cast<std::chrono::seconds>(delta);
   std::cout << "average fps: " << frame_count / duration_s.count() << std::endl;
+  std::cout << "average steps/s: "
+            << timestep.get_step_count() / timestep.get_run_time() << std::endl;
 #endif
 }
 
@@ -1,11 +1,19 @@
 #ifndef APP_HPP
 #define APP_HPP
 
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+
 #include "../simulake/renderer.hpp"
 #include "../simulake/grid_base.hpp"
 #include "../simulake/device_grid.hpp"
 #include "../simulake/grid.hpp"
+#include "../simulake/triple_buffer.hpp"
 #include "appstate.hpp"
+#include "brush.hpp"
+#include "timestep.hpp"
 #include "window.hpp"
 
 namespace simulake {
@@ -19,8 +27,54 @@ public:
   /* run main render loop */
   void run(const bool, GridBase::serialized_grid_t *) noexcept;
 
+  /* cpu grid cell traversal order */
+  inline void set_traversal(const Grid::Traversal order) noexcept {
+    grid.set_traversal(order);
+  }
+
+  /* simulation steps per rendered frame */
+  inline void set_substeps(const std::uint32_t substeps) noexcept {
+    timestep.set_substeps(substeps);
+  }
+
+  /* most steps run at once to catch up after a slow frame */
+  inline void set_max_steps(const std::uint32_t steps) noexcept {
+    timestep.set_max_steps(steps);
+  }
+
+  /* opencl device the gpu mode grid runs on */
+  inline void
+  set_device_options(const DeviceGrid::device_options_t &options) noexcept {
+    device_options = options;
+  }
+
+  /* cell layout of the gpu mode grid in device memory */
+  inline void set_device_layout(const DeviceGrid::Layout layout) noexcept {
+    device_layout = layout;
+  }
+
 private:
-  void step_sim(bool, GridBase *) noexcept;
+  /* input sampled on the render thread, applied by the simulation. mouse
+   * painting is queued separately, see AppState::push_brush_event */
+  struct input_t {
+    bool paused = false;
+  };
+
+  /* completed cpu grid frame */
+  struct frame_t {
+    GridBase::serialized_grid_t grid;
+  };
+
+  /* sample input from app state */
+  input_t poll_input() const noexcept;
+
+  /* paint queued brush events, then step the grid given number of fixed
+   * timesteps. returns true if the grid changed */
+  bool step_sim(GridBase *, const std::uint32_t) noexcept;
+
+  /* simulation thread of the cpu grid, steps as real time elapses and
+   * publishes each changed frame to frames until stopped */
+  void run_sim(std::stop_token, GridBase *) noexcept;
 
   const AppState &state;
 
@@ -28,7 +82,20 @@ private:
   Renderer renderer;
 
   Grid grid;
-  DeviceGrid device_grid;
+  std::unique_ptr<DeviceGrid> device_grid; /* created by run, if asked for */
+  DeviceGrid::device_options_t device_options;
+  DeviceGrid::Layout device_layout = DeviceGrid::Layout::CELLS;
+
+  /* latest input, render thread to simulation thread */
+  std::mutex input_mutex;
+  input_t input;
+
+  /* completed cpu grid frames, simulation thread to render thread */
+  TripleBuffer<frame_t> frames;
+
+  /* fixed timestep and brush of whichever thread steps the grid */
+  Timestep timestep;
+  Brush brush;
 };
 
 } /* namespace simulake */
@@ -1,3 +1,5 @@
+#include <utility>
+
 #include "appstate.hpp"
 
 namespace simulake {
@@ -39,6 +41,11 @@ void AppState::set_spawn_radius(const std::uint32_t num_cells) noexcept {
   state.renderer->submit_shader_uniforms(uniforms_to_update);
 }
 
+void AppState::set_brush_shape(const BrushShape shape) noexcept {
+  AppState &state = AppState::get_instance();
+  state.brush_shape = shape;
+}
+
 void AppState::set_cell_size(const std::uint32_t cell_size) noexcept {
   AppState &state = AppState::get_instance();
   state.cell_size = cell_size;
@@ -51,7 +58,7 @@ void AppState::set_cell_size(const std::uint32_t cell_size) noexcept {
 
 void AppState::set_mouse_pressed(const bool pressed) noexcept {
   AppState &state = AppState::get_instance();
-  state.mouse_pressed = pressed;
+  state.mouse_pressed.store(pressed, std::memory_order_release);
 }
 
 void AppState::set_erase_mode(const bool erase_mode) noexcept {
@@ -101,6 +108,37 @@ void AppState::set_paused(const bool paused) noexcept {
   state.paused = paused;
 }
 
+void AppState::request_store() noexcept {
+  AppState &state = AppState::get_instance();
+  state.store_requested = true;
+}
+
+bool AppState::take_store_request() noexcept {
+  AppState &state = AppState::get_instance();
+  return std::exchange(state.store_requested, false);
+}
+
+void AppState::push_brush_event(const brush_event_t::Kind kind) noexcept {
+  AppState &state = AppState::get_instance();
+
+  /* NOTE(vir): a full queue drops the event, at 1024 events per step only
+   * possible while the simulation is stalled */
+  state.brush_events.push({
+      .kind = kind,
+      .time = std::chrono::steady_clock::now(),
+      .x = state.prev_mouse_x / state.window_width,
+      .y = state.prev_mouse_y / state.window_height,
+      .radius = state.spawn_radius,
+      .shape = state.brush_shape,
+      .target = get_target_type(),
+  });
+}
+
+bool AppState::pop_brush_event(brush_event_t &event) noexcept {
+  AppState &state = AppState::get_instance();
+  return state.brush_events.pop(event);
+}
+
 CellType AppState::get_target_type() noexcept {
   AppState &state = AppState::get_instance();
   return state.erase_mode ? CellType::AIR : state.selected_cell_type;
@@ -131,6 +169,11 @@ std::uint32_t AppState::get_spawn_radius() noexcept {
   return state.spawn_radius;
 }
 
+BrushShape AppState::get_brush_shape() noexcept {
+  AppState &state = AppState::get_instance();
+  return state.brush_shape;
+}
+
 std::uint32_t AppState::get_cell_size() noexcept {
   AppState &state = AppState::get_instance();
   return state.cell_size;
@@ -138,7 +181,7 @@ std::uint32_t AppState::get_cell_size() noexcept {
 
 bool AppState::is_mouse_pressed() noexcept {
   AppState &state = AppState::get_instance();
-  return state.mouse_pressed;
+  return state.mouse_pressed.load(std::memory_order_acquire);
 }
 
 bool AppState::is_erase_mode() noexcept {
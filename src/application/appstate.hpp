@@ -1,9 +1,13 @@
 #ifndef APP_STATE_HPP
 #define APP_STATE_HPP
 
+#include <atomic>
+
 #include "../simulake/cell.hpp"
 #include "../simulake/renderer.hpp"
 #include "../simulake/grid_base.hpp"
+#include "../simulake/spsc_queue.hpp"
+#include "brush.hpp"
 #include "window.hpp"
 
 /* `AppState` is a singleton class used to store and update data required by
@@ -42,6 +46,9 @@ public:
   /* update the mouse interaction spawn radius (in cells) */
   static void set_spawn_radius(const std::uint32_t) noexcept;
 
+  /* update the footprint of mouse painting */
+  static void set_brush_shape(const BrushShape) noexcept;
+
   /* update the cell size (pixels) */
   static void set_cell_size(const std::uint32_t) noexcept;
 
@@ -63,6 +70,19 @@ public:
   /* set/get if simulation is paused */
   static void set_paused(const bool) noexcept;
 
+  /* ask the app to store the grid to disk, taken (and cleared) by the app
+   * when it can serialize safely */
+  static void request_store() noexcept;
+  static bool take_store_request() noexcept;
+
+  /* queue a brush event of given kind at the current mouse position, radius
+   * and target. called by the glfw callbacks (render thread) */
+  static void push_brush_event(const brush_event_t::Kind) noexcept;
+
+  /* take the oldest queued brush event, false if there is none. called by
+   * the thread stepping the grid */
+  static bool pop_brush_event(brush_event_t &) noexcept;
+
   /* get current target cell type accounting for modifiers (e.g. erase mode) */
   static CellType get_target_type() noexcept;
 
@@ -72,6 +92,7 @@ public:
   static GridBase *get_grid() noexcept;
   static simulake::CellType get_selected_cell_type() noexcept;
   static std::uint32_t get_spawn_radius() noexcept;
+  static BrushShape get_brush_shape() noexcept;
   static std::uint32_t get_cell_size() noexcept;
   static std::uint32_t get_window_width() noexcept;
   static std::uint32_t get_window_height() noexcept;
@@ -93,6 +114,7 @@ private:
 
   simulake::CellType selected_cell_type = simulake::CellType::NONE;
   std::uint32_t spawn_radius = 20;
+  BrushShape brush_shape = BrushShape::DISC;
   std::uint32_t cell_size = 1;
 
   /* track height and width of the window */
@@ -107,9 +129,15 @@ private:
   float prev_time = 0.0f;  /* time at the previous frame */
   float delta_time = 0.0f; /* time between previous and current frame*/
 
-  bool mouse_pressed = false;
+  /* NOTE(vir): read by the thread stepping the grid, which ends the stroke
+   * once it is clear in case the queue dropped its release */
+  std::atomic<bool> mouse_pressed = false;
   bool erase_mode = false;
   bool paused = false; /* pause the simulation when true */
+  bool store_requested = false;
+
+  /* brush events, glfw callbacks to the simulation */
+  SpscQueue<brush_event_t, 1024> brush_events;
 };
 
 } /* namespace simulake */
@@ -0,0 +1,104 @@
+#include "brush.hpp"
+
+namespace simulake {
+
+Brush::Brush(const std::uint32_t _width, const std::uint32_t _height)
+    : width(_width), height(_height), raster(_width, _height) {}
+
+void Brush::add(const brush_event_t &event) noexcept {
+  switch (event.kind) {
+  case brush_event_t::Kind::PRESS:
+    stamp(event);
+    stroking = true;
+    break;
+
+  case brush_event_t::Kind::MOVE:
+    if (stroking)
+      stroke(last, event);
+    break;
+
+  case brush_event_t::Kind::RELEASE:
+    if (stroking)
+      stroke(last, event);
+    stroking = false;
+    break;
+  }
+
+  last = event;
+}
+
+bool Brush::paint(GridBase *grid,
+                  const std::chrono::steady_clock::time_point now) noexcept {
+  /* NOTE(vir): last.time doubles as the time of the latest stamp */
+  if (stroking and stamps.empty() and now - last.time >= HOLD_PERIOD) {
+    last.time = now;
+    stamp(last);
+  }
+
+  if (stamps.empty())
+    return false;
+
+  for (std::size_t begin = 0, end = 0; begin < stamps.size(); begin = end) {
+    while (end < stamps.size() and stamps[end].target == stamps[begin].target)
+      end += 1;
+
+    rasterize(begin, end);
+    grid->paint_cells(mask);
+  }
+
+  stamps.clear();
+  return true;
+}
+
+void Brush::stamp(const brush_event_t &event) noexcept {
+  stroke(event, event);
+}
+
+void Brush::stroke(const brush_event_t &from,
+                   const brush_event_t &to) noexcept {
+  stamps.push_back({
+      .x0 = static_cast<int>(width * from.x),
+      .y0 = static_cast<int>(height * from.y),
+      .x1 = static_cast<int>(width * to.x),
+      .y1 = static_cast<int>(height * to.y),
+      .radius = to.radius,
+      .shape = to.shape,
+      .target = to.target,
+  });
+}
+
+void Brush::rasterize(const std::size_t begin,
+                      const std::size_t end) noexcept {
+  for (std::size_t i = begin; i < end; i += 1) {
+    const stamp_t &s = stamps[i];
+
+    switch (s.shape) {
+    case BrushShape::DISC:
+      raster.line(s.x0, s.y0, s.x1, s.y1, s.radius);
+      break;
+
+    case BrushShape::SQUARE: {
+      raster.square(s.x0, s.y0, s.radius);
+      if (s.x0 == s.x1 and s.y0 == s.y1)
+        break;
+
+      raster.square(s.x1, s.y1, s.radius);
+
+      /* the squares' hull adds the band between the two corners furthest
+       * either side of the segment */
+      const float h = s.radius + 0.5f;
+      const glm::vec2 a{s.x0 + 0.5f, s.y0 + 0.5f};
+      const glm::vec2 b{s.x1 + 0.5f, s.y1 + 0.5f};
+      const glm::vec2 c{s.y1 > s.y0 ? -h : h, s.x1 < s.x0 ? -h : h};
+
+      raster.polygon({a + c, b + c, b - c, a - c});
+      break;
+    }
+    }
+  }
+
+  raster.take(mask);
+  mask.target = stamps[begin].target;
+}
+
+} /* namespace simulake */
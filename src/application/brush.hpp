@@ -0,0 +1,92 @@
+#ifndef APP_BRUSH_HPP
+#define APP_BRUSH_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "../simulake/brush_raster.hpp"
+#include "../simulake/grid_base.hpp"
+
+namespace simulake {
+
+/* footprint of a brush stamp */
+enum class BrushShape : std::uint8_t {
+  DISC,   /* cells within radius of the mouse */
+  SQUARE, /* cells within radius of the mouse along both axes */
+};
+
+/* mouse painting sample, pushed by the glfw callbacks */
+struct brush_event_t {
+  enum class Kind : std::uint8_t {
+    PRESS,   /* stroke starts */
+    MOVE,    /* stroke continues to this sample */
+    RELEASE, /* stroke ends */
+  };
+
+  Kind kind = Kind::MOVE;
+  std::chrono::steady_clock::time_point time;
+  float x = 0.0f;                   /* in [0, 1] of window width */
+  float y = 0.0f;                   /* in [0, 1] of window height */
+  std::uint32_t radius = 0;         /* in cells */
+  BrushShape shape = BrushShape::DISC;
+  CellType target = CellType::NONE; /* AIR erases */
+};
+
+/* Brush turns brush events into paint batches. consecutive samples of a
+ * stroke are joined by sweeping the brush shape along the segment between
+ * them, so fast strokes leave no gaps, and all stamps of one step are
+ * rasterized into a single batch, so overlapping stamps write each cell
+ * once */
+class Brush {
+public:
+  /* a brush held still keeps pouring once per period */
+  static constexpr std::chrono::duration<double> HOLD_PERIOD{1.0 / 60.0};
+
+  /* brush for a grid of given size in cells */
+  explicit Brush(const std::uint32_t, const std::uint32_t);
+
+  /* add event to the current stroke */
+  void add(const brush_event_t &) noexcept;
+
+  /* end the current stroke, if any */
+  inline void release() noexcept { stroking = false; }
+
+  /* paint all stamps added since the last call, one batch per run of equal
+   * targets. returns true if anything was painted */
+  bool paint(GridBase *, const std::chrono::steady_clock::time_point) noexcept;
+
+private:
+  /* brush swept from (x0, y0) to (x1, y1), in cells. a single stamp starts
+   * and ends at the same cell */
+  struct stamp_t {
+    int x0, y0;
+    int x1, y1;
+    std::uint32_t radius;
+    BrushShape shape;
+    CellType target;
+  };
+
+  /* stamp at event position */
+  void stamp(const brush_event_t &) noexcept;
+
+  /* sweep from one event position to the next */
+  void stroke(const brush_event_t &, const brush_event_t &) noexcept;
+
+  /* rasterize stamps [begin, end) into mask */
+  void rasterize(const std::size_t, const std::size_t) noexcept;
+
+  std::uint32_t width;
+  std::uint32_t height;
+
+  std::vector<stamp_t> stamps; /* pending, in stroke order */
+  BrushRaster raster;
+  GridBase::paint_mask_t mask; /* reused between batches */
+
+  brush_event_t last;  /* latest sample of the current stroke */
+  bool stroking = false;
+};
+
+} /* namespace simulake */
+
+#endif
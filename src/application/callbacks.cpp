@@ -5,7 +5,6 @@
 
 #include "../simulake/cell.hpp"
 #include "../utils.hpp"
-#include "loader.hpp"
 
 namespace simulake {
 namespace callbacks {
@@ -45,14 +44,19 @@ void key(GLFWwindow *window, int key, int scancode, int action, int mods) {
   if (key == GLFW_KEY_8 && action == GLFW_PRESS)
     state.set_selected_cell_type(simulake::CellType::GREEK_FIRE);
 
+  /* toggle brush shape between disc and square */
+  if (key == GLFW_KEY_B && action == GLFW_PRESS)
+    state.set_brush_shape(state.get_brush_shape() == BrushShape::DISC
+                              ? BrushShape::SQUARE
+                              : BrushShape::DISC);
+
   /* debug: print app state to console */
   if (key == GLFW_KEY_P && action == GLFW_PRESS)
     std::cout << state;
 
-  if (key == GLFW_KEY_S && action == GLFW_PRESS) {
-    std::cout << "stored grid to disk" << std::endl;
-    Loader::store_grid(state.get_grid()->serialize());
-  }
+  /* store grid to disk, the grid may be stepping on the sim thread */
+  if (key == GLFW_KEY_S && action == GLFW_PRESS)
+    state.request_store();
 }
 
 void cursor_enter(GLFWwindow *window, int entered) {
@@ -67,6 +71,9 @@ void cursor_enter(GLFWwindow *window, int entered) {
 void cursor_pos(GLFWwindow *window, double xpos, double ypos) {
   AppState &state = AppState::get_instance();
   state.set_mouse_pos(xpos, ypos);
+
+  if (state.is_mouse_pressed())
+    state.push_brush_event(brush_event_t::Kind::MOVE);
 }
 
 void mouse_button(GLFWwindow *window, int button, int action, int mods) {
@@ -77,7 +84,9 @@ void mouse_button(GLFWwindow *window, int button, int action, int mods) {
     if (action == GLFW_PRESS) {
       state.set_erase_mode(false);
       state.set_mouse_pressed(true);
+      state.push_brush_event(brush_event_t::Kind::PRESS);
     } else if (action == GLFW_RELEASE) {
+      state.push_brush_event(brush_event_t::Kind::RELEASE);
       state.set_erase_mode(false);
       state.set_mouse_pressed(false);
     }
@@ -87,7 +96,9 @@ void mouse_button(GLFWwindow *window, int button, int action, int mods) {
     if (action == GLFW_PRESS) {
       state.set_erase_mode(true);
       state.set_mouse_pressed(true);
+      state.push_brush_event(brush_event_t::Kind::PRESS);
     } else if (action == GLFW_RELEASE) {
+      state.push_brush_event(brush_event_t::Kind::RELEASE);
       state.set_erase_mode(false);
       state.set_mouse_pressed(false);
     }
@@ -101,6 +112,10 @@ void scroll(GLFWwindow *window, double xoffset, double yoffset) {
       std::min(state.get_window_width(), state.get_window_height()) / 4;
   offset = std::clamp(offset, 1, min_dim + 1);
   state.set_spawn_radius(static_cast<std::uint32_t>(offset));
+
+  /* resize a stroke in progress */
+  if (state.is_mouse_pressed())
+    state.push_brush_event(brush_event_t::Kind::MOVE);
 }
 
 void framebuffer_size(GLFWwindow *window, int width, int height) {
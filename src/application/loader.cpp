@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
@@ -10,6 +11,12 @@
 
 namespace simulake {
 
+/* leads every save since version 2, version 1 saves start with the width */
+constexpr std::uint32_t GRID_MAGIC = 0x4B4C4D53; /* "SMLK" */
+
+/* device grid cells per save, version 1 stored them column major */
+constexpr std::uint32_t DEVICE_STRIDE = 4;
+
 GridBase::serialized_grid_t Loader::load_grid(const std::string_view path) {
   std::filesystem::path file_path(path);
 
@@ -25,7 +32,23 @@ GridBase::serialized_grid_t Loader::load_grid(const std::string_view path) {
 
   GridBase::serialized_grid_t grid;
 
-  input_file.read(reinterpret_cast<char *>(&grid.width), sizeof(grid.width));
+  std::uint32_t magic = 0;
+  input_file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+
+  if (magic == GRID_MAGIC) {
+    input_file.read(reinterpret_cast<char *>(&grid.version),
+                    sizeof(grid.version));
+    input_file.read(reinterpret_cast<char *>(&grid.width), sizeof(grid.width));
+  } else {
+    grid.version = 1;
+    grid.width = magic;
+  }
+
+  if (grid.version == 0 or
+      grid.version > GridBase::serialized_grid_t::VERSION) {
+    throw std::runtime_error("Unsupported grid file version.");
+  }
+
   input_file.read(reinterpret_cast<char *>(&grid.height), sizeof(grid.height));
   input_file.read(reinterpret_cast<char *>(&grid.stride), sizeof(grid.stride));
 
@@ -47,6 +70,22 @@ GridBase::serialized_grid_t Loader::load_grid(const std::string_view path) {
     std::exit(-1);
   }
 
+  /* NOTE(vir): version 1 device grids indexed cells col * height + row,
+   * reorder them to the row major order every grid reads now. cpu grid saves
+   * were already row major */
+  if (grid.version == 1 and grid.stride == DEVICE_STRIDE) {
+    std::vector<float> rows(grid.buffer.size());
+    for (std::uint32_t row = 0; row < grid.height; row += 1) {
+      for (std::uint32_t col = 0; col < grid.width; col += 1) {
+        const std::size_t from = (col * grid.height + row) * grid.stride;
+        const std::size_t to = (row * grid.width + col) * grid.stride;
+        std::copy_n(&grid.buffer[from], grid.stride, &rows[to]);
+      }
+    }
+    grid.buffer = std::move(rows);
+  }
+
+  grid.version = GridBase::serialized_grid_t::VERSION;
   return grid;
 }
 
@@ -89,6 +128,10 @@ void Loader::store_grid(const GridBase::serialized_grid_t &data,
     throw std::runtime_error("Failed to open file for writing.");
   }
 
+  const std::uint32_t magic = GRID_MAGIC;
+  output_file.write(reinterpret_cast<const char *>(&magic), sizeof(magic));
+  output_file.write(reinterpret_cast<const char *>(&data.version),
+                    sizeof(data.version));
   output_file.write(reinterpret_cast<const char *>(&data.width),
                     sizeof(data.width));
   output_file.write(reinterpret_cast<const char *>(&data.height),
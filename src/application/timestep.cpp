@@ -0,0 +1,46 @@
+#include <algorithm>
+
+#include "timestep.hpp"
+
+namespace simulake {
+
+Timestep::Timestep(const float frame_rate, const std::uint32_t substeps,
+                   const std::uint32_t max_steps)
+    : frame_time(1.0f / frame_rate) {
+  set_substeps(substeps);
+  set_max_steps(max_steps);
+}
+
+std::uint32_t Timestep::advance(const float elapsed) noexcept {
+  accumulated += std::max(elapsed, 0.0f);
+
+  std::uint32_t steps = 0;
+  while (accumulated >= step_time && steps < max_steps) {
+    accumulated -= step_time;
+    steps += 1;
+  }
+
+  /* NOTE(vir): over the cap, fall behind real time rather than trying to
+   * catch up later */
+  if (accumulated >= step_time)
+    accumulated = 0.0f;
+
+  step_count += steps;
+  run_time += elapsed;
+
+  return steps;
+}
+
+void Timestep::reset() noexcept {
+  accumulated = 0.0f;
+}
+
+void Timestep::set_substeps(const std::uint32_t steps) noexcept {
+  substeps = steps > 0 ? steps : 1;
+  step_time = frame_time / substeps;
+
+  if (accumulated >= step_time)
+    accumulated = 0.0f;
+}
+
+} /* namespace simulake */
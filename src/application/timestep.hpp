@@ -0,0 +1,67 @@
+#ifndef APP_TIMESTEP_HPP
+#define APP_TIMESTEP_HPP
+
+#include <cstdint>
+
+namespace simulake {
+
+/* Timestep turns elapsed real time into a whole number of fixed size
+ * simulation steps. time is accumulated and consumed one step at a time, so
+ * rules that scale with delta time (e.g. sand gravity) behave the same at any
+ * frame rate. a hitch runs at most max_steps steps at once, the rest of it is
+ * dropped instead of snowballing into ever longer catch-up frames */
+class Timestep {
+public:
+  /* frame rate the simulation targets, steps per frame, catch-up cap */
+  explicit Timestep(const float = 60.0f, const std::uint32_t = 1,
+                    const std::uint32_t = 8);
+
+  /* accumulate elapsed seconds, returns the number of steps now due */
+  std::uint32_t advance(const float) noexcept;
+
+  /* discard accumulated time, e.g. while paused */
+  void reset() noexcept;
+
+  /* delta time of every step */
+  inline float get_delta_time() const noexcept { return step_time; }
+
+  /* accumulated time not yet stepped, as a fraction of one step in [0, 1).
+   * NOTE(vir): only exposed, nothing interpolates by it yet since the grids
+   * keep a single state */
+  inline float get_alpha() const noexcept { return accumulated / step_time; }
+
+  /* seconds until the next step is due */
+  inline float get_time_to_step() const noexcept {
+    return step_time - accumulated;
+  }
+
+  /* steps per frame, each one frame_time / substeps long */
+  inline std::uint32_t get_substeps() const noexcept { return substeps; }
+  void set_substeps(const std::uint32_t) noexcept;
+
+  /* most steps a single advance returns */
+  inline std::uint32_t get_max_steps() const noexcept { return max_steps; }
+  inline void set_max_steps(const std::uint32_t steps) noexcept {
+    max_steps = steps > 0 ? steps : 1;
+  }
+
+  /* total steps and real seconds advanced, their ratio is the simulation
+   * throughput independent of the display rate */
+  inline std::uint64_t get_step_count() const noexcept { return step_count; }
+  inline double get_run_time() const noexcept { return run_time; }
+
+private:
+  float frame_time;
+  float step_time;
+  float accumulated = 0.0f;
+
+  std::uint32_t substeps;
+  std::uint32_t max_steps;
+
+  std::uint64_t step_count = 0;
+  double run_time = 0.0;
+};
+
+} /* namespace simulake */
+
+#endif
@@ -7,9 +7,14 @@
 #include "test.hpp"
 
 int main(int argc, char *argv[]) {
-  std::uint32_t grid_width, grid_height, cell_size;
+  std::uint32_t grid_width, grid_height, cell_size, substeps, max_steps;
+  std::uint32_t bench_steps = 0;
+  std::uint32_t check_steps = 0;
   std::string grid_file = "";
   bool gpu_mode;
+  simulake::DeviceGrid::device_options_t device_options;
+  auto device_layout = simulake::DeviceGrid::Layout::CELLS;
+  auto traversal = simulake::Grid::Traversal::ROWS;
 
   cxxopts::Options options(argv[0], "A cellular automata physics simulator.\n");
 
@@ -19,7 +24,15 @@ int main(int argc, char *argv[]) {
     ("y,height",     "grid height in cells",    cxxopts::value<std::uint32_t>()->default_value("200"))
     ("c,cellsize",   "cell size in pixels",     cxxopts::value<std::uint32_t>()->default_value("4"))
     ("g,gpu",        "enable GPU acceleration", cxxopts::value<bool>())
+    ("d,device",     "opencl device: gpu, cpu, accelerator, any, index or name (implies -g)", cxxopts::value<std::string>())
+    ("devices",      "list opencl devices")
+    ("layout",       "gpu cell layout: cells, planes", cxxopts::value<std::string>()->default_value("cells"))
+    ("bench",        "time given number of gpu steps with each cell layout", cxxopts::value<std::uint32_t>())
+    ("check",        "check cpu grid conservation over given number of steps", cxxopts::value<std::uint32_t>())
     ("l,load",       "load scene from disk",    cxxopts::value<std::string>())
+    ("t,traversal",  "cpu cell order: rows, columns, tiles", cxxopts::value<std::string>()->default_value("rows"))
+    ("s,substeps",   "simulation steps per frame", cxxopts::value<std::uint32_t>()->default_value("1"))
+    ("m,maxsteps",   "most steps run to catch up", cxxopts::value<std::uint32_t>()->default_value("8"))
     ("h,help",       "print help");
   // clang-format on
 
@@ -30,6 +43,36 @@ int main(int argc, char *argv[]) {
       exit(EXIT_SUCCESS);
     }
 
+    if (result.count("devices")) {
+      const auto devices = simulake::DeviceGrid::list_devices();
+      for (std::size_t index = 0; index < devices.size(); index += 1) {
+        const auto &device = devices[index];
+        const auto type = (device.type & CL_DEVICE_TYPE_GPU)   ? "gpu"
+                          : (device.type & CL_DEVICE_TYPE_CPU) ? "cpu"
+                                                               : "other";
+
+        std::cout << index << ": [" << type << "] " << device.device_name
+                  << " (" << device.platform_name << ")" << std::endl;
+      }
+
+      if (devices.empty())
+        std::cout << "no opencl devices found" << std::endl;
+      exit(EXIT_SUCCESS);
+    }
+
+    if (result.count("device")) {
+      device_options = simulake::DeviceGrid::parse_device_spec(
+          result["device"].as<std::string>());
+    }
+
+    if (result.count("bench")) {
+      bench_steps = result["bench"].as<std::uint32_t>();
+    }
+
+    if (result.count("check")) {
+      check_steps = result["check"].as<std::uint32_t>();
+    }
+
     if (result.count("load")) {
       grid_file = result["load"].as<std::string>();
     }
@@ -38,13 +81,51 @@ int main(int argc, char *argv[]) {
     cell_size = result["cellsize"].as<std::uint32_t>();
     grid_width = result["width"].as<std::uint32_t>();
     grid_height = result["height"].as<std::uint32_t>();
-    gpu_mode = result["gpu"].as<bool>();
+    gpu_mode = result["gpu"].as<bool>() or result.count("device") > 0;
+    substeps = result["substeps"].as<std::uint32_t>();
+    max_steps = result["maxsteps"].as<std::uint32_t>();
+
+    const auto order = result["traversal"].as<std::string>();
+    if (order == "rows") {
+      traversal = simulake::Grid::Traversal::ROWS;
+    } else if (order == "columns") {
+      traversal = simulake::Grid::Traversal::COLUMNS;
+    } else if (order == "tiles") {
+      traversal = simulake::Grid::Traversal::TILES;
+    } else {
+      std::cerr << "error: unknown traversal: " << order << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+    const auto layout = result["layout"].as<std::string>();
+    if (layout == "cells") {
+      device_layout = simulake::DeviceGrid::Layout::CELLS;
+    } else if (layout == "planes") {
+      device_layout = simulake::DeviceGrid::Layout::PLANES;
+    } else {
+      std::cerr << "error: unknown layout: " << layout << std::endl;
+      exit(EXIT_FAILURE);
+    }
     std::cout << "gpu_mode: " << gpu_mode << std::endl; /*__DEBUG_PRINT__*/
   } catch (const cxxopts::exceptions::exception &e) {
     std::cerr << "error: " << e.what() << std::endl;
     exit(EXIT_FAILURE);
   }
 
+  /* NOTE(vir): benchmarks run headless, without a window */
+  if (bench_steps > 0) {
+    simulake::test::bench_device_layouts(grid_width, grid_height, bench_steps,
+                                         device_options);
+    return 0;
+  }
+
+  if (check_steps > 0) {
+    return simulake::test::check_conservation(grid_width, grid_height,
+                                              check_steps)
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+  }
+
   /* init and run application */
   simulake::init_window_context();
 
@@ -59,6 +140,11 @@ int main(int argc, char *argv[]) {
 
   simulake::App app =
       simulake::App{grid_width, grid_height, cell_size, "simulake"};
+  app.set_traversal(traversal);
+  app.set_substeps(substeps);
+  app.set_max_steps(max_steps);
+  app.set_device_options(device_options);
+  app.set_device_layout(device_layout);
 
   {
     PROFILE_SCOPE("total run time");
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cmath>
+
+#include "brush_raster.hpp"
+
+namespace simulake {
+
+BrushRaster::BrushRaster(const std::uint32_t _width,
+                         const std::uint32_t _height)
+    : width(_width), height(_height) {}
+
+void BrushRaster::disc(const int x, const int y,
+                       const std::uint32_t radius) noexcept {
+  const auto &half = disc_spans(radius);
+  const int r = static_cast<int>(radius);
+
+  for (int dy = -r; dy <= r; dy += 1) {
+    const int h = static_cast<int>(half[std::abs(dy)]);
+    add_span(y + dy, x - h, x + h + 1);
+  }
+}
+
+void BrushRaster::square(const int x, const int y,
+                         const std::uint32_t radius) noexcept {
+  const int r = static_cast<int>(radius);
+
+  for (int dy = -r; dy <= r; dy += 1)
+    add_span(y + dy, x - r, x + r + 1);
+}
+
+void BrushRaster::line(const int x0, const int y0, const int x1, const int y1,
+                       const std::uint32_t radius) noexcept {
+  disc(x0, y0, radius);
+  if (x0 == x1 and y0 == y1)
+    return;
+
+  disc(x1, y1, radius);
+
+  /* the band between the end discs, offset radius either side of the
+   * segment between the cell centers. widened a hair so that cells exactly
+   * radius away are inside, as they are for discs */
+  const glm::vec2 a{x0 + 0.5f, y0 + 0.5f};
+  const glm::vec2 b{x1 + 0.5f, y1 + 0.5f};
+  const glm::vec2 d = b - a;
+  const glm::vec2 n =
+      glm::vec2{-d.y, d.x} * ((radius + 1.0f / 1024) / glm::length(d));
+
+  polygon({a + n, b + n, b - n, a - n});
+}
+
+void BrushRaster::polygon(const std::vector<glm::vec2> &points) noexcept {
+  if (points.size() < 3)
+    return;
+
+  float min_y = points[0].y, max_y = points[0].y;
+  for (const auto &p : points) {
+    min_y = std::min(min_y, p.y);
+    max_y = std::max(max_y, p.y);
+  }
+
+  /* rows whose center line crosses the polygon */
+  const int y_begin = std::max(static_cast<int>(std::ceil(min_y - 0.5f)), 0);
+  const int y_end = std::min(static_cast<int>(std::floor(max_y - 0.5f)) + 1,
+                             static_cast<int>(height));
+
+  for (int y = y_begin; y < y_end; y += 1) {
+    const float cy = y + 0.5f;
+
+    crossings.clear();
+    for (std::size_t i = 0, j = points.size() - 1; i < points.size(); j = i++) {
+      const glm::vec2 &a = points[j], &b = points[i];
+      if ((a.y <= cy) != (b.y <= cy))
+        crossings.push_back(a.x + (cy - a.y) * (b.x - a.x) / (b.y - a.y));
+    }
+
+    std::sort(crossings.begin(), crossings.end());
+
+    /* cells whose center lies between a pair of crossings */
+    for (std::size_t i = 0; i + 1 < crossings.size(); i += 2) {
+      add_span(y, static_cast<int>(std::ceil(crossings[i] - 0.5f)),
+               static_cast<int>(std::floor(crossings[i + 1] - 0.5f)) + 1);
+    }
+  }
+}
+
+void BrushRaster::take(GridBase::paint_mask_t &mask) noexcept {
+  std::sort(spans.begin(), spans.end(), [](const auto &a, const auto &b) {
+    return a.y != b.y ? a.y < b.y : a.x_begin < b.x_begin;
+  });
+
+  auto &merged = mask.spans;
+  merged.clear();
+  std::uint32_t x_min = width, x_max = 0;
+
+  /* merge overlapping and touching spans of a row */
+  for (const auto &span : spans) {
+    if (!merged.empty() and merged.back().y == span.y and
+        merged.back().x_end >= span.x_begin) {
+      merged.back().x_end = std::max(merged.back().x_end, span.x_end);
+    } else {
+      merged.push_back(span);
+    }
+
+    x_min = std::min(x_min, span.x_begin);
+    x_max = std::max(x_max, span.x_end);
+  }
+
+  if (merged.empty()) {
+    mask.x = mask.y = mask.width = mask.height = 0;
+  } else {
+    mask.x = x_min;
+    mask.y = merged.front().y;
+    mask.width = x_max - x_min;
+    mask.height = merged.back().y + 1 - mask.y;
+  }
+
+  spans.clear();
+}
+
+const std::vector<std::uint32_t> &
+BrushRaster::disc_spans(const std::uint32_t radius) noexcept {
+  if (disc_tables.size() <= radius)
+    disc_tables.resize(radius + 1);
+
+  auto &half = disc_tables[radius];
+  if (half.empty()) {
+    /* widest h with h^2 + dy^2 <= radius^2 */
+    const std::int64_t r2 = static_cast<std::int64_t>(radius) * radius;
+    half.resize(radius + 1);
+
+    for (std::int64_t dy = 0; dy <= radius; dy += 1) {
+      std::int64_t h = static_cast<std::int64_t>(std::sqrt(r2 - dy * dy));
+      while (h * h + dy * dy > r2)
+        h -= 1;
+      while ((h + 1) * (h + 1) + dy * dy <= r2)
+        h += 1;
+      half[dy] = static_cast<std::uint32_t>(h);
+    }
+  }
+
+  return half;
+}
+
+void BrushRaster::add_span(const int y, const int x_begin,
+                           const int x_end) noexcept {
+  if (y < 0 or y >= static_cast<int>(height))
+    return;
+
+  const int begin = std::max(x_begin, 0);
+  const int end = std::min(x_end, static_cast<int>(width));
+  if (begin < end) {
+    spans.push_back({.y = static_cast<std::uint32_t>(y),
+                     .x_begin = static_cast<std::uint32_t>(begin),
+                     .x_end = static_cast<std::uint32_t>(end)});
+  }
+}
+
+} /* namespace simulake */
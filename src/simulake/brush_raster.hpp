@@ -0,0 +1,62 @@
+#ifndef SIMULAKE_BRUSH_RASTER_HPP
+#define SIMULAKE_BRUSH_RASTER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "grid_base.hpp"
+
+namespace simulake {
+
+/* BrushRaster scan converts brush shapes into row spans of painted cells.
+ * shapes added between two takes are unioned, so every cell of the batch is
+ * painted once however much they overlap. all work is per row, a shape costs
+ * O(rows) here and O(painted cells) to fill.
+ *
+ * coordinates are in cells, cell (x, y) covers [x, x + 1) x [y, y + 1) and a
+ * cell is inside a shape iff its center is. cells outside the grid are
+ * clipped */
+class BrushRaster {
+public:
+  explicit BrushRaster(const std::uint32_t, const std::uint32_t);
+
+  /* disc of given radius centered on cell (x, y) */
+  void disc(const int, const int, const std::uint32_t) noexcept;
+
+  /* square of side 2 * radius + 1 centered on cell (x, y) */
+  void square(const int, const int, const std::uint32_t) noexcept;
+
+  /* cells within radius of the segment between cells (x0, y0) and (x1, y1),
+   * i.e. a disc swept along it */
+  void line(const int, const int, const int, const int,
+            const std::uint32_t) noexcept;
+
+  /* polygon through given points (even-odd rule), any winding */
+  void polygon(const std::vector<glm::vec2> &) noexcept;
+
+  /* move the union of all shapes added since the last take into mask spans
+   * and bounding box, leaving the raster empty. the target is left as is */
+  void take(GridBase::paint_mask_t &) noexcept;
+
+  /* true if no shape covered a cell since the last take */
+  inline bool empty() const noexcept { return spans.empty(); }
+
+private:
+  /* half width of each row of a disc of given radius, rows [0, radius] from
+   * the center out. computed once per radius */
+  const std::vector<std::uint32_t> &disc_spans(const std::uint32_t) noexcept;
+
+  /* add cells [x_begin, x_end) of row y, clipped to the grid */
+  void add_span(const int, const int, const int) noexcept;
+
+  std::uint32_t width;
+  std::uint32_t height;
+
+  std::vector<GridBase::paint_span_t> spans; /* unsorted, may overlap */
+  std::vector<std::vector<std::uint32_t>> disc_tables; /* by radius */
+  std::vector<float> crossings; /* polygon scratch */
+};
+
+} /* namespace simulake */
+
+#endif
@@ -1,3 +1,4 @@
+#include <bit>
 #include <iostream>
 #include <utility>
 
@@ -8,9 +9,6 @@
 
 namespace simulake {
 
-std::random_device BaseCell::rd;
-std::mt19937 BaseCell::gen(BaseCell::rd());
-
 bool BaseCell::is_liquid(CellType type) {
   return type == CellType::WATER or type == CellType::OIL or type == CellType::JET_FUEL;
 }
@@ -47,32 +45,125 @@ float BaseCell::flammability(CellType type) {
   };
 }
 
-/* compute neighbor types and return as 8 element tuple */
+/* compute neighbor types and return as 8 element tuple, out of bounds
+ * neighbors are ghost cells (CellType::NONE) so reads are unchecked */
 BaseCell::context_t BaseCell::get_cell_context(const BaseCell::position_t &pos,
                                                const Grid &grid) noexcept {
-  const auto [x, y] = pos;
+  const int x = static_cast<int>(std::get<0>(pos));
+  const int y = static_cast<int>(std::get<1>(pos));
   return {
-      grid.cell_at(x - 1, y - 1).type, // top left
-      grid.cell_at(x, y - 1).type,     // top
-      grid.cell_at(x + 1, y - 1).type, // top right
-      grid.cell_at(x - 1, y).type,     // left
-      grid.cell_at(x + 1, y).type,     // right
-      grid.cell_at(x - 1, y + 1).type, // bottom left
-      grid.cell_at(x, y + 1).type,     // bottom
-      grid.cell_at(x + 1, y + 1).type  // bottom right
+      grid.unchecked_type_at(x - 1, y - 1), // top left
+      grid.unchecked_type_at(x, y - 1),     // top
+      grid.unchecked_type_at(x + 1, y - 1), // top right
+      grid.unchecked_type_at(x - 1, y),     // left
+      grid.unchecked_type_at(x + 1, y),     // right
+      grid.unchecked_type_at(x - 1, y + 1), // bottom left
+      grid.unchecked_type_at(x, y + 1),     // bottom
+      grid.unchecked_type_at(x + 1, y + 1)  // bottom right
   };
 }
 
-float BaseCell::random_float(float lower, float upper) {
-  std::uniform_real_distribution<float> dist(lower, upper);
-  return dist(gen);
+float BaseCell::random_float(rng_t &rng, float lower, float upper) {
+  return rng.next_float(lower, upper);
+}
+
+int BaseCell::random_int(rng_t &rng, int lower, int upper) {
+  return rng.next_int(lower, upper);
+}
+
+/* <<<<<<<< ROW KERNELS >>>>>>>>> */
+
+namespace {
+
+/* target cells of a word-wide move: bits of the row word at x0, plus the
+ * single cells just left and right of it */
+struct open_row_t {
+  std::uint64_t word;
+  bool left, right;
+};
+
+/* cells of row y around word x0 having any of the given material bits (see
+ * BaseCell::materials) and not yet claimed by another move this frame */
+open_row_t open_row(const Grid &grid, std::uint8_t materials, int x0, int y) {
+  const bool has_right = x0 + 64 <= static_cast<int>(grid.get_width());
+  open_row_t open{0, false, false};
+
+  for (std::uint8_t m = 0; m < static_cast<std::uint8_t>(Material::COUNT);
+       m += 1) {
+    if (((materials >> m) & 1) == 0)
+      continue;
+
+    const auto material = static_cast<Material>(m);
+    open.word |= grid.material_bits(material, x0, y);
+    open.left |= grid.has_material(material, x0 - 1, y);
+    open.right |= has_right and grid.has_material(material, x0 + 64, y);
+  }
+
+  if (open.word != 0)
+    open.word &= ~grid.updated_bits(x0, y);
+
+  open.left = open.left and !grid.updated(x0 - 1, y);
+  open.right = open.right and !grid.updated(x0 + 64, y);
+  return open;
+}
+
+/* split movers into straight (dx = 0), left (dx = -1) and right (dx = +1)
+ * moves into distinct open targets. straight moves win, the rest go to
+ * their preferred diagonal (bit set in prefer_left) if open, else the other
+ * one if still open */
+struct row_moves_t {
+  std::uint64_t straight, left, right;
+};
+
+row_moves_t resolve_moves(std::uint64_t movers, open_row_t open,
+                          std::uint64_t prefer_left) {
+  const std::uint64_t edge_left = open.left ? 1 : 0;
+  const std::uint64_t edge_right = open.right ? std::uint64_t{1} << 63 : 0;
+
+  const std::uint64_t straight = movers & open.word;
+  const std::uint64_t rest = movers & ~straight;
+  std::uint64_t targets = open.word & ~straight;
+
+  const std::uint64_t can_left = rest & ((targets << 1) | edge_left);
+  const std::uint64_t can_right = rest & ((targets >> 1) | edge_right);
+  const std::uint64_t left = can_left & (prefer_left | ~can_right);
+
+  targets &= ~(left >> 1);
+  const std::uint64_t right = rest & ~left & ((targets >> 1) | edge_right);
+
+  return {straight, left, right};
+}
+
+/* move the cells set in bits from row y to row ty, shifted by dx. the
+ * target's next state takes the mover's place. movers another rule already
+ * changed this frame (e.g. ignited) stay put. single cell moves do not
+ * carry velocity */
+void apply_moves(Grid &grid, std::uint64_t bits, int x0, int y, int dx,
+                 int ty, CellType type, float mass_delta) {
+  for (; bits != 0; bits &= bits - 1) {
+    const int x = x0 + std::countr_zero(bits);
+
+    cell_data_t cell = grid.unchecked_cell_at(x, y, true);
+    if (cell.type != type)
+      continue;
+
+    const cell_data_t displaced = grid.unchecked_cell_at(x + dx, ty, true);
+    cell.mass += mass_delta;
+    cell.velocity = glm::vec2{0.0f};
+    cell.updated = true;
+
+    grid.mark_updated(x + dx, ty);
+    grid.set_next(x + dx, ty, cell);
+    grid.set_next(x, y, displaced);
+  }
 }
 
-int BaseCell::random_int(int lower, int upper) {
-  std::uniform_int_distribution<int> dist(lower, upper);
-  return dist(gen);
+constexpr std::uint8_t material_bit(Material m) {
+  return static_cast<std::uint8_t>(1 << static_cast<std::uint8_t>(m));
 }
 
+} // namespace
+
 /* <<<<<<<< AIR >>>>>>>>> */
 
 cell_data_t AirCell::spawn(const position_t &pos, Grid &grid) noexcept {
@@ -82,11 +173,6 @@ cell_data_t AirCell::spawn(const position_t &pos, Grid &grid) noexcept {
   };
 }
 
-void AirCell::step(const position_t &pos, Grid &grid) noexcept {
-  const auto [x, y] = pos;
-  const auto context = BaseCell::get_cell_context(pos, grid);
-}
-
 /* <<<<<<<< SMOKE >>>>>>>>> */
 
 cell_data_t SmokeCell::spawn(const position_t &pos, Grid &grid) noexcept {
@@ -97,72 +183,87 @@ cell_data_t SmokeCell::spawn(const position_t &pos, Grid &grid) noexcept {
   };
 }
 
-void SmokeCell::step(const position_t &pos, Grid &grid) noexcept {
-  const auto [x, y] = pos;
-  const auto context = get_cell_context(pos, grid);
-  const auto curr = grid.cell_at(x, y);
-
-  bool decayed = curr.mass <= 0.0f;
-
-  /* generate a random number between 0 and 1 */
-  float p = 0.4;
-  float rand_num = random_float(0.0f, 1.0f);
-
-  if (decayed) {
-    grid.set_next(x, y, {.type = CellType::AIR});
-  }
+void SmokeCell::step_row(int x_start, int x_end, int y, Grid &grid) noexcept {
+  const int x0 = x_start & ~63;
+  const std::uint64_t smoke = grid.type_bits(CellType::SMOKE, x_start, x_end, y);
 
-  /* will flow up if possible */
-  else if (is_fluid(context.top)) {
-    if (rand_num < p) {
-      grid.set_next(x, y, {.type = CellType::AIR});
-      grid.set_next(x, y - 1,
-                    {.type = CellType::SMOKE, .mass = curr.mass - mass_decay});
-    }
-  }
+  if (smoke == 0)
+    return;
 
-  /* else flow left if possible */
-  else if (is_fluid(context.top_left)) {
-    if (rand_num < p) {
-      grid.set_next(x, y, {.type = CellType::AIR});
-      grid.set_next(x - 1, y - 1,
-                    {.type = CellType::SMOKE, .mass = curr.mass - mass_decay});
-    }
+  /* decayed smoke turns into air */
+  std::uint64_t decayed = 0;
+  for (std::uint64_t bits = smoke; bits != 0; bits &= bits - 1) {
+    const int i = std::countr_zero(bits);
+    if (grid.unchecked_cell_at(x0 + i, y).mass <= 0.0f)
+      decayed |= std::uint64_t{1} << i;
   }
 
-  /* else flow right if possible */
-  else if (is_fluid(context.top_right)) {
-    if (rand_num < p) {
+  const std::uint64_t live = smoke & ~decayed;
+
+  /* each cell rises with p = 0.375 (0.5 * 0.75), into air only */
+  auto rng = grid.rng_at(x0, y, Grid::ROW_STREAM);
+  const std::uint64_t rises =
+      rng.next_bits() & (rng.next_bits() | rng.next_bits());
+  const std::uint64_t prefer_left = rng.next_bits();
+
+  const open_row_t open =
+      open_row(grid, material_bit(Material::EMPTY), x0, y - 1);
+  const row_moves_t moves = resolve_moves(live & rises, open, prefer_left);
+  const std::uint64_t moved = moves.straight | moves.left | moves.right;
+
+  // clang-format off
+  apply_moves(grid, moves.straight, x0, y,  0, y - 1, CellType::SMOKE, -mass_decay);
+  apply_moves(grid, moves.left,     x0, y, -1, y - 1, CellType::SMOKE, -mass_decay);
+  apply_moves(grid, moves.right,    x0, y,  1, y - 1, CellType::SMOKE, -mass_decay);
+  // clang-format on
+
+  /* cells with any fluid above wait for it to clear (or to roll a rise),
+   * cells with none are stuck and decay in place */
+  const std::uint64_t fluid =
+      grid.material_bits(Material::FLUID, x0 - 1, y - 1) |
+      grid.material_bits(Material::FLUID, x0, y - 1) |
+      grid.material_bits(Material::FLUID, x0 + 1, y - 1);
+  const std::uint64_t waiting = live & ~moved & fluid;
+  const std::uint64_t stuck = live & ~moved & ~fluid;
+
+  for (std::uint64_t bits = waiting; bits != 0; bits &= bits - 1)
+    grid.keep_awake(x0 + std::countr_zero(bits), y);
+
+  for (std::uint64_t bits = stuck | decayed; bits != 0; bits &= bits - 1) {
+    const int x = x0 + std::countr_zero(bits);
+    const cell_data_t cell = grid.unchecked_cell_at(x, y, true);
+
+    if (cell.type != CellType::SMOKE)
+      continue; // changed by another rule
+
+    if (cell.mass <= 0.0f)
       grid.set_next(x, y, {.type = CellType::AIR});
-      grid.set_next(x + 1, y - 1,
-                    {.type = CellType::SMOKE, .mass = curr.mass - mass_decay});
-    }
-  }
-
-  /* else stuck, decay in place */
-  else {
-    grid.set_next(x, y,
-                  {.type = CellType::SMOKE, .mass = curr.mass - mass_decay});
+    else
+      grid.set_next(x, y,
+                    {.type = CellType::SMOKE, .mass = cell.mass - mass_decay});
   }
 }
 
 /* <<<<<<<< FIRE >>>>>>>> */
 
 cell_data_t FireCell::spawn(const position_t &pos, Grid &grid) noexcept {
+  const auto [x, y] = pos;
+  auto rng = grid.rng_at(x, y, Grid::SPAWN_STREAM);
+
   return {
       .type = CellType::FIRE,
-      .mass = random_float(0.6f, 1.0f),
+      .mass = random_float(rng, 0.6f, 1.0f),
       .updated = true,
   };
 }
 
-void FireCell::helper(CellType curr, Grid &grid, int x, int y,
+void FireCell::helper(CellType curr, Grid &grid, rng_t &rng, int x, int y,
                       float remaining_mass) {
   if (flammability(curr) > 0) {
     grid.set_next(x, y, {.type = CellType::FIRE, .mass = remaining_mass});
   } else if (curr == CellType::AIR) {
     float p = 0.4;
-    float rand_num = random_float(0.0f, 1.0f);
+    float rand_num = random_float(rng, 0.0f, 1.0f);
     if (rand_num < p) {
       grid.set_next(
           x, y, {.type = CellType::SMOKE, .mass = remaining_mass - mass_decay});
@@ -174,7 +275,9 @@ void FireCell::step(const position_t &pos, Grid &grid) noexcept {
   const auto [x, y] = pos;
   const auto context = BaseCell::get_cell_context(pos, grid);
 
-  float fire_mass = grid.cell_at(x, y).mass;
+  auto rng = grid.rng_at(x, y);
+
+  float fire_mass = grid.unchecked_cell_at(x, y).mass;
   float remaining_mass = fire_mass - mass_decay;
 
   if (remaining_mass <= 0.0f) {
@@ -182,21 +285,218 @@ void FireCell::step(const position_t &pos, Grid &grid) noexcept {
     return;
   }
 
-  FireCell::helper(context.top, grid, x, y - 1, remaining_mass);
-  FireCell::helper(context.top_left, grid, x - 1, y - 1, remaining_mass);
-  FireCell::helper(context.top_right, grid, x + 1, y - 1, remaining_mass);
+  // clang-format off
+  FireCell::helper(context.top,          grid, rng, x,     y - 1, remaining_mass);
+  FireCell::helper(context.top_left,     grid, rng, x - 1, y - 1, remaining_mass);
+  FireCell::helper(context.top_right,    grid, rng, x + 1, y - 1, remaining_mass);
 
-  FireCell::helper(context.bottom, grid, x, y + 1, remaining_mass);
-  FireCell::helper(context.bottom_left, grid, x - 1, y + 1, remaining_mass);
-  FireCell::helper(context.bottom_right, grid, x + 1, y + 1, remaining_mass);
+  FireCell::helper(context.bottom,       grid, rng, x,     y + 1, remaining_mass);
+  FireCell::helper(context.bottom_left,  grid, rng, x - 1, y + 1, remaining_mass);
+  FireCell::helper(context.bottom_right, grid, rng, x + 1, y + 1, remaining_mass);
 
-  FireCell::helper(context.left, grid, x - 1, y, remaining_mass);
-  FireCell::helper(context.right, grid, x + 1, y, remaining_mass);
+  FireCell::helper(context.left,         grid, rng, x - 1, y,     remaining_mass);
+  FireCell::helper(context.right,        grid, rng, x + 1, y,     remaining_mass);
+  // clang-format on
 
   grid.set_next(
       x, y, {.type = CellType::FIRE, .mass = std::max(0.0f, remaining_mass)});
 }
 
+/* <<<<<<<< GREEK FIRE >>>>>>>> */
+
+cell_data_t GreekFireCell::spawn(const position_t &pos, Grid &grid) noexcept {
+  const auto [x, y] = pos;
+  auto rng = grid.rng_at(x, y, Grid::SPAWN_STREAM);
+
+  return {
+      .type = CellType::GREEK_FIRE,
+      .mass = random_float(rng, 0.2f, 1.0f),
+      .updated = true,
+  };
+}
+
+void GreekFireCell::step(const position_t &pos, Grid &grid) noexcept {
+  const auto [x, y] = pos;
+  const auto context = BaseCell::get_cell_context(pos, grid);
+
+  auto rng = grid.rng_at(x, y);
+  const float remaining_mass = grid.unchecked_mass_at(x, y) - mass_decay;
+
+  /* flares up again instead of burning out */
+  if (remaining_mass <= 0.0f) {
+    grid.set_next(x, y, {.type = CellType::GREEK_FIRE,
+                         .mass = random_float(rng, 0.2f, 1.0f)});
+    return;
+  }
+
+  /* ignite flammable neighbors, smoke into air */
+  const auto spread = [&](CellType curr, int nx, int ny) {
+    if (flammability(curr) > 0) {
+      grid.set_next(nx, ny, {.type = CellType::FIRE, .mass = remaining_mass});
+    } else if (curr == CellType::AIR and random_float(rng, 0.0f, 1.0f) < 0.4f) {
+      grid.set_next(nx, ny, {.type = CellType::SMOKE,
+                             .mass = random_float(rng, 0.0f, 1.0f)});
+    }
+  };
+
+  // clang-format off
+  spread(context.top,          x,     y - 1);
+  spread(context.top_left,     x - 1, y - 1);
+  spread(context.top_right,    x + 1, y - 1);
+
+  spread(context.bottom,       x,     y + 1);
+  spread(context.bottom_left,  x - 1, y + 1);
+  spread(context.bottom_right, x + 1, y + 1);
+  // clang-format on
+
+  grid.set_next(x, y, {.type = CellType::GREEK_FIRE, .mass = remaining_mass});
+}
+
+/* <<<<<<<< LIQUIDS >>>>>>>> */
+
+void LiquidCell::flow_row(CellType liquid, int x_start, int x_end, int y,
+                          Grid &grid) noexcept {
+  const int x0 = x_start & ~63;
+  const std::uint64_t liquid_bits = grid.type_bits(liquid, x_start, x_end, y);
+
+  if (liquid_bits == 0)
+    return;
+
+  /* lane i is cell x0 + i - 1, lanes 0 and 65 are the cells just outside
+   * the word. a flow belongs to the word of the cell it leaves, so each
+   * horizontal pair is levelled once even across words */
+  constexpr int LANES = 64 + 2;
+  const int lo = std::countr_zero(liquid_bits) + 1;
+  const int hi = 64 - std::countl_zero(liquid_bits);
+
+  /* cells a liquid may flow into: its own type, air and gases */
+  const auto open = [liquid](CellType type) {
+    const std::uint8_t bits = materials(type);
+    return type == liquid or
+           ((bits & material_bit(Material::FLUID)) != 0 and
+            (bits & material_bit(Material::LIQUID)) == 0);
+  };
+
+  float mass[LANES] = {}, below[LANES] = {}, above[LANES] = {};
+  bool move[LANES] = {}, open_row[LANES] = {};
+  bool open_below[LANES] = {}, open_above[LANES] = {};
+
+  /* gather the next state, others may have moved cells this frame */
+  for (int i = lo - 1; i <= hi + 1; i += 1) {
+    const int x = x0 + i - 1;
+    const CellType type = grid.unchecked_type_at(x, y, true);
+
+    open_row[i] = open(type);
+    mass[i] = type == liquid ? grid.unchecked_mass_at(x, y, true) : 0.0f;
+    move[i] = i >= lo and i <= hi and ((liquid_bits >> (i - 1)) & 1) and
+              type == liquid;
+  }
+
+  for (int i = lo - 1; i <= hi + 1; i += 1) {
+    const int x = x0 + i - 1;
+    const CellType type = grid.unchecked_type_at(x, y + 1, true);
+
+    open_below[i] = open(type);
+    below[i] = type == liquid ? grid.unchecked_mass_at(x, y + 1, true) : 0.0f;
+  }
+
+  for (int i = lo; i <= hi; i += 1) {
+    const int x = x0 + i - 1;
+    const CellType type = grid.unchecked_type_at(x, y - 1, true);
+
+    open_above[i] = move[i] and open(type);
+    above[i] = type == liquid ? grid.unchecked_mass_at(x, y - 1, true) : 0.0f;
+  }
+
+  float start[LANES], start_below[LANES], start_above[LANES];
+  std::copy_n(mass, LANES, start);
+  std::copy_n(below, LANES, start_below);
+  std::copy_n(above, LANES, start_above);
+
+  /* NOTE(vir): the flows below are branch free over whole lanes, so they
+   * vectorize. lanes that cannot flow compute a flow and drop it */
+
+  /* down, towards the stable state */
+  for (int i = 0; i < LANES; i += 1) {
+    float flow = get_stable_state_b(mass[i] + below[i]) - below[i];
+    flow *= flow > min_flow ? dampen : 1.0f;
+    flow = std::clamp(flow, 0.0f, std::min(max_speed, mass[i]));
+    flow = move[i] and open_below[i] ? flow : 0.0f;
+
+    mass[i] -= flow;
+    below[i] += flow;
+  }
+
+  /* down the diagonals, so liquid runs off slopes instead of only
+   * spreading out. not through corners, the side cell must be open too */
+  float run_left[LANES] = {}, run_right[LANES] = {};
+  for (int i = 1; i < LANES - 1; i += 1) {
+    const bool can_left = move[i] and open_row[i - 1] and open_below[i - 1];
+    const bool can_right = move[i] and open_row[i + 1] and open_below[i + 1];
+    const float left = (mass[i] - below[i - 1]) / 2.0f;
+    const float right = (mass[i] - below[i + 1]) / 2.0f;
+
+    run_left[i] = can_left ? std::clamp(left, 0.0f, mass[i] / 2.0f) : 0.0f;
+    run_right[i] = can_right ? std::clamp(right, 0.0f, mass[i] / 2.0f) : 0.0f;
+  }
+
+  for (int i = 1; i < LANES - 1; i += 1) {
+    mass[i] -= run_left[i] + run_right[i];
+    below[i - 1] += run_left[i];
+    below[i + 1] += run_right[i];
+  }
+
+  /* level out with the neighbors. all pairs flow from the same masses, and
+   * each at most a quarter of the cell, so no cell goes negative */
+  for (int pass = 0; pass < spread_passes; pass += 1) {
+    float shift[LANES - 1]; /* from lane i to lane i + 1 */
+    for (int i = 0; i < LANES - 1; i += 1) {
+      const float flow = (mass[i] - mass[i + 1]) / 4.0f;
+      const bool can_flow = flow > 0.0f ? move[i] and open_row[i + 1]
+                                        : move[i + 1] and open_row[i];
+      shift[i] = can_flow and std::abs(flow) >= settle_flow ? flow : 0.0f;
+    }
+
+    for (int i = 0; i < LANES - 1; i += 1) {
+      mass[i] -= shift[i];
+      mass[i + 1] += shift[i];
+    }
+  }
+
+  /* up, if compressed */
+  for (int i = 0; i < LANES; i += 1) {
+    float flow = mass[i] - get_stable_state_b(mass[i] + above[i]);
+    flow *= flow > min_flow ? 0.5f : 1.0f;
+    flow = std::clamp(flow, 0.0f, std::min(max_speed, mass[i]));
+    flow = open_above[i] ? flow : 0.0f;
+
+    mass[i] -= flow;
+    above[i] += flow;
+  }
+
+  /* scatter changed cells, cells too light to hold liquid evaporate */
+  const auto scatter = [&grid, liquid](int x, int y, float mass) {
+    const bool updated = grid.unchecked_cell_at(x, y, true).updated;
+
+    if (mass >= min_mass)
+      grid.set_next(x, y, {.type = liquid, .mass = mass, .updated = updated});
+    else if (grid.unchecked_type_at(x, y, true) == liquid)
+      grid.set_next(x, y, {.type = CellType::AIR, .updated = updated});
+  };
+
+  for (int i = lo - 1; i <= hi + 1; i += 1) {
+    if (mass[i] != start[i] or (move[i] and mass[i] < min_mass))
+      scatter(x0 + i - 1, y, mass[i]);
+  }
+
+  for (int i = lo - 1; i <= hi + 1; i += 1) {
+    if (below[i] != start_below[i])
+      scatter(x0 + i - 1, y + 1, below[i]);
+    if (above[i] != start_above[i])
+      scatter(x0 + i - 1, y - 1, above[i]);
+  }
+}
+
 /* <<<<<<<< WATER >>>>>>>> */
 
 cell_data_t WaterCell::spawn(const position_t &pos, Grid &grid) noexcept {
@@ -207,11 +507,42 @@ cell_data_t WaterCell::spawn(const position_t &pos, Grid &grid) noexcept {
   };
 }
 
+void WaterCell::step_row(int x_start, int x_end, int y, Grid &grid) noexcept {
+  const int x0 = x_start & ~63;
+  const std::uint64_t water =
+      grid.type_bits(CellType::WATER, x_start, x_end, y);
+
+  if (water == 0)
+    return;
+
+  /* water sinks below oil, swapping places */
+  std::uint64_t sinks = 0;
+  for (std::uint64_t bits = water; bits != 0; bits &= bits - 1) {
+    const int i = std::countr_zero(bits);
+    if (grid.unchecked_type_at(x0 + i, y + 1, true) == CellType::OIL)
+      sinks |= std::uint64_t{1} << i;
+  }
+
+  apply_moves(grid, sinks, x0, y, 0, y + 1, CellType::WATER, 0.0f);
+  flow_row(CellType::WATER, x_start, x_end, y, grid);
+}
+
+/* <<<<<<<< OIL >>>>>>>> */
 
-void WaterCell::step(const position_t &pos, Grid &grid) noexcept{
+cell_data_t OilCell::spawn(const position_t &pos, Grid &grid) noexcept {
+  return {
+      .type = CellType::OIL,
+      .mass = spawn_mass,
+      .updated = true,
+  };
+}
 
+void OilCell::step_row(int x_start, int x_end, int y, Grid &grid) noexcept {
+  flow_row(CellType::OIL, x_start, x_end, y, grid);
 }
 
+/* <<<<<<<< JET FUEL >>>>>>>> */
+
 cell_data_t JetFuelCell::spawn(const position_t &, Grid &) noexcept {
   return {
     .type = CellType::JET_FUEL,
@@ -223,21 +554,21 @@ cell_data_t JetFuelCell::spawn(const position_t &, Grid &) noexcept {
 void JetFuelCell::step(const position_t &pos, Grid &grid) noexcept {
   const auto [x, y] = pos;
 
-  cell_data_t current_cell = grid.cell_at(x, y);
-
+  cell_data_t current_cell = grid.unchecked_cell_at(x, y);
+  auto rng = grid.rng_at(x, y);
 
   // Check downward movement
-  cell_data_t below_cell = grid.cell_at(x, y + 1);
+  cell_data_t below_cell = grid.unchecked_cell_at(x, y + 1);
 
-  if (below_cell.type == CellType::JET_FUEL and random_int(0, 1000) == 0) {
+  if (below_cell.type == CellType::JET_FUEL and random_int(rng, 0, 1000) == 0) {
     // spontaneously combust with varying intensity
-    grid.set_next(x, y, { .type = CellType::FIRE, .mass = random_float(0.0, 4.0) });
+    grid.set_next(x, y, { .type = CellType::FIRE, .mass = random_float(rng, 0.0, 4.0) });
     return;
   }
 
-  if (!is_fluid(below_cell.type) and random_int(0, 10) == 0) {
+  if (!is_fluid(below_cell.type) and random_int(rng, 0, 10) == 0) {
     // spontaneously combust with varying intensity
-    grid.set_next(x, y, { .type = CellType::FIRE, .mass = random_float(0.0, 2.0) });
+    grid.set_next(x, y, { .type = CellType::FIRE, .mass = random_float(rng, 0.0, 2.0) });
     return;
   }
 
@@ -252,9 +583,9 @@ void JetFuelCell::step(const position_t &pos, Grid &grid) noexcept {
   }
 
   // Check lateral movement (left and right)
-  int direction = random_int(-1, 1);
+  int direction = random_int(rng, -1, 1);
 
-  cell_data_t side_cell = grid.cell_at(x + direction, y);
+  cell_data_t side_cell = grid.unchecked_cell_at(x + direction, y);
   if (!side_cell.updated and (side_cell.type == CellType::AIR or side_cell.type == CellType::SMOKE)) {
     // mark updated
     grid.mark_updated(x + direction, y);
@@ -265,99 +596,11 @@ void JetFuelCell::step(const position_t &pos, Grid &grid) noexcept {
     return;
   }
 
-  // Water remains in the current cell
+  // Water remains in the current cell, may still combust next frame
   grid.set_next(x, y, current_cell);
+  grid.keep_awake(x, y);
 }
 
-// void WaterCell::step(const position_t &pos, Grid &grid) noexcept {
-//   const auto [x, y] = pos;
-//   const auto context = BaseCell::get_cell_context(pos, grid);
-//
-//   float flow;
-//   float remaining_mass = grid.cell_at(x, y).mass;
-//   if (remaining_mass <= 0) {
-//     grid.set_next(x, y, { .type = CellType::AIR });
-//     return;
-//   }
-//
-//   // Flow to block below.
-//   if (is_fluid(context.bottom)) {
-//     flow = get_stable_state_b(remaining_mass + grid.cell_at(x, y + 1).mass) - grid.cell_at(x, y + 1).mass;
-//
-//     // Smoother flow.
-//     if (flow > min_flow) flow *= 0.5;
-//
-//     flow = constrain(flow, 0, std::min(max_speed, remaining_mass));
-//
-//     // flow into neighbor, add to mass of neighbor, remove mass from current
-//     grid.set_next(x, y + 1, { .type = CellType::WATER, .mass = grid.cell_at(x, y + 1, true).mass + flow });
-//     grid.set_next(x, y, { .type = CellType::WATER, .mass = grid.cell_at(x, y, true).mass - flow });
-//
-//     remaining_mass -= flow;
-//   }
-//
-//   if (remaining_mass <= 0) {
-//     grid.set_next(x, y, { .type = CellType::AIR });
-//     return;
-//   }
-//
-//   // Equalize water with right block.
-//   if (is_fluid(context.right)) {
-//     flow = (grid.cell_at(x, y).mass - grid.cell_at(x + 1, y).mass) / 4;
-//
-//     // Smoother flow.
-//     if (flow > min_flow) flow *= 0.5;
-//
-//     flow = constrain(flow, 0, remaining_mass);
-//
-//     grid.set_next(x + 1, y, { .type = CellType::WATER, .mass = grid.cell_at(x + 1, y, true).mass + flow });
-//     grid.set_next(x, y, { .type = CellType::WATER, .mass = grid.cell_at(x, y, true).mass - flow });
-//
-//     remaining_mass -= flow;
-//   }
-//
-//   if (remaining_mass <= 0) {
-//     grid.set_next(x, y, { .type = CellType::AIR });
-//     return;
-//   }
-//
-//   // Equalize water with left block.
-//   if (is_fluid(context.left)) {
-//     flow = (grid.cell_at(x, y).mass - grid.cell_at(x - 1, y).mass) / 4;
-//
-//     // Smoother flow.
-//     if (flow > min_flow) flow *= 0.5;
-//
-//     flow = constrain(flow, 0, remaining_mass);
-//
-//     grid.set_next(x - 1, y, { .type = CellType::WATER, .mass = grid.cell_at(x - 1, y, true).mass + flow });
-//     grid.set_next(x, y, { .type = CellType::WATER, .mass = grid.cell_at(x, y, true).mass - flow });
-//
-//
-//     remaining_mass -= flow;
-//   }
-//
-//   if (remaining_mass <= 0) {
-//     grid.set_next(x, y, { .type = CellType::AIR });
-//     return;
-//   }
-//
-//   // If compressed, flow up.
-//   if (is_fluid(context.top)) {
-//     flow = remaining_mass - get_stable_state_b(remaining_mass + grid.cell_at(x, y - 1).mass);
-//
-//     // Smoother flow.
-//     if (flow > min_flow) flow *= 0.5;
-//
-//     flow = constrain(flow, 0, std::min(max_speed, remaining_mass));
-//
-//     grid.set_next(x, y - 1, { .type = CellType::WATER, .mass = grid.cell_at(x, y - 1, true).mass + flow });
-//     grid.set_next(x, y, { .type = CellType::WATER, .mass = grid.cell_at(x, y, true).mass - flow });
-//
-//     remaining_mass -= flow;
-//   }
-// }
-
 /* <<<<<<<< SAND >>>>>>>> */
 
 cell_data_t SandCell::spawn(const position_t &pos, Grid &grid) noexcept {
@@ -367,103 +610,79 @@ cell_data_t SandCell::spawn(const position_t &pos, Grid &grid) noexcept {
   };
 }
 
-void SandCell::step(const position_t &pos, Grid &grid) noexcept {
-  const auto dt = grid.get_delta_time();
-  const auto [x, y] = pos;
+void SandCell::step_row(int x_start, int x_end, int y, Grid &grid) noexcept {
+  const int x0 = x_start & ~63;
+  const std::uint64_t sand = grid.type_bits(CellType::SAND, x_start, x_end, y);
 
-  cell_data_t new_cell = grid.cell_at(x, y);
+  if (sand == 0)
+    return;
 
-  // gravity is effectively 50 for sand, mult by 3 to fix flying horizontally
-  new_cell.velocity.y =
-      std::clamp(new_cell.velocity.y + (gravity * 5.f * dt), -10.f, 10.f);
+  /* fall into air or sink through liquids, else slide diagonally */
+  const open_row_t open = open_row(
+      grid, material_bit(Material::EMPTY) | material_bit(Material::LIQUID), x0,
+      y + 1);
 
-  // reset velocity if not able to move directly below
-  if (grid.in_bounds(x, y + 1) and !grid.is_empty(x, y + 1) and
-      !is_liquid(grid.cell_at(x, y + 1).type)) {
-    new_cell.velocity.y /= 2.f;
-  }
+  if (open.word == 0 and !open.left and !open.right)
+    return;
 
-  glm::ivec2 vi{static_cast<int>(x) + static_cast<int>(new_cell.velocity.x),
-                static_cast<int>(y) + static_cast<int>(new_cell.velocity.y)};
-
-  // check if can swap with element below
-  glm::ivec2 bottom{x, y + 1};
-  glm::ivec2 bottom_right{x + 1, y + 1};
-  glm::ivec2 bottom_left{x - 1, y + 1};
-
-  cell_data_t tmp_a = grid.cell_at(x, y);
-
-  // physics (using velocity)
-  if (grid.in_bounds(vi.x, vi.y) and
-      ((grid.is_empty(vi.x, vi.y) ||
-        (((grid.cell_at(vi.x, vi.y).type == CellType::WATER) and
-          !grid.cell_at(vi.x, vi.y).updated and
-          glm::length(grid.cell_at(vi.x, vi.y).velocity) -
-                  glm::length(tmp_a.velocity) >
-              10.f))))) {
-
-    cell_data_t tmp_b = grid.cell_at(vi.x, vi.y);
-
-    // try to throw water out
-    if (tmp_b.type == CellType::WATER) {
-
-      int rx = random_int(-2, 2);
-      tmp_b.velocity = glm::vec2{rx, -4.f};
-
-      grid.set_next(vi.x, vi.y, tmp_a);
-
-      for (int i = -10; i < 0; ++i) {
-        for (int j = -10; j < 10; ++j) {
-          if (grid.is_empty(vi.x + j, vi.y + i)) {
-            grid.set_next(vi.x + j, vi.y + i, tmp_b);
-            break;
-          }
-        }
-      }
-
-      // couldn't write here, destroy it
-      grid.set_next(x, y, cell_data_t{.type = CellType::AIR});
-    } else if (grid.is_empty(vi.x, vi.y)) {
-      grid.set_next(vi.x, vi.y, tmp_a);
-      grid.set_next(x, y, tmp_b);
-    }
+  auto rng = grid.rng_at(x0, y, Grid::ROW_STREAM);
+  const row_moves_t moves = resolve_moves(sand, open, rng.next_bits());
+
+  /* sand falling out of air into a liquid splashes a quarter of the time,
+   * throwing the liquid up as a particle. otherwise they swap places */
+  const std::uint64_t splash = moves.straight &
+                               grid.material_bits(Material::EMPTY, x0, y - 1) &
+                               grid.material_bits(Material::LIQUID, x0, y + 1) &
+                               rng.next_bits() & rng.next_bits();
+
+  for (std::uint64_t bits = splash; bits != 0; bits &= bits - 1) {
+    const int x = x0 + std::countr_zero(bits);
+    const glm::vec2 velocity{rng.next_float(-1.5f, 1.5f),
+                             -rng.next_float(2.0f, 4.0f)};
+
+    if (grid.unchecked_type_at(x, y, true) == CellType::SAND)
+      grid.eject(x, y + 1, velocity);
   }
-  // simple falling
-  else if (grid.in_bounds(x, y + 1) &&
-           ((grid.is_empty(x, y + 1) or
-             (grid.cell_at(bottom.x, bottom.y).type == CellType::WATER)))) {
-    new_cell.velocity.y += (gravity * dt);
-    cell_data_t tmp_b = grid.cell_at(x, y + 1);
-    grid.set_next(bottom.x, bottom.y, new_cell);
-    grid.set_next(x, y, tmp_b);
-  } else if (grid.in_bounds(x - 1, y + 1) and
-             ((grid.is_empty(x - 1, y + 1) or
-               grid.cell_at(bottom_right.x, bottom_right.y).type ==
-                   CellType::WATER))) {
-    new_cell.velocity.x =
-        grid.is_in_liquid(x, y)[0] == 1 ? 0.f : random_float(-2, 2);
-    new_cell.velocity.y += (gravity * dt);
-    cell_data_t tmp_b = grid.cell_at(x - 1, y + 1);
-    grid.set_next(bottom_left.x, bottom_left.y, new_cell);
-    grid.set_next(x, y, tmp_b);
-  } else if (grid.in_bounds(x + 1, y + 1) &&
-             ((grid.is_empty(x + 1, y + 1) or
-               grid.cell_at(bottom_right.x, bottom_right.y).type ==
-                   CellType::WATER))) {
-    new_cell.velocity.x =
-        grid.is_in_liquid(x, y)[0] == 1 ? 0.f : random_float(-2, 2);
-    new_cell.velocity.y += (gravity * dt);
-    cell_data_t tmp_b = grid.cell_at(x + 1, y + 1);
-    grid.set_next(bottom_right.x, bottom_right.y, new_cell);
-    grid.set_next(x, y, tmp_b);
-  } else if (random_int(0, 10) == 0) {
-    glm::vec3 in_liquid = grid.is_in_liquid(x, y);
-    if (in_liquid[0] == 1) {
-      cell_data_t tmp_b = grid.cell_at(in_liquid[1], in_liquid[2]);
-      grid.set_next(in_liquid[1], in_liquid[2], new_cell);
-      grid.set_next(x, y, tmp_b);
-    }
+
+  /* sand falling into air speeds up, and falls as far as its velocity takes
+   * it this step, swept so it stops on top of the first blocker */
+  const std::uint64_t falling =
+      moves.straight & grid.material_bits(Material::EMPTY, x0, y + 1);
+  const float dv = gravity * 5.f * grid.get_delta_time();
+
+  for (std::uint64_t bits = falling; bits != 0; bits &= bits - 1) {
+    const int x = x0 + std::countr_zero(bits);
+
+    cell_data_t cell = grid.unchecked_cell_at(x, y, true);
+    if (cell.type != CellType::SAND)
+      continue;
+
+    cell.velocity.y = std::min(cell.velocity.y + dv, max_velocity);
+    const int reach = std::max(static_cast<int>(cell.velocity.y), 1);
+    const auto [end, blocker] = grid.sweep(x, y, x, y + reach);
+
+    if (end.y == y)
+      continue;
+
+    /* landed, the fall is over */
+    if (end != blocker or !grid.has_material(Material::EMPTY, x, end.y + 1))
+      cell.velocity.y = 0.0f;
+
+    const cell_data_t displaced = grid.unchecked_cell_at(x, end.y, true);
+    cell.updated = true;
+
+    grid.mark_updated(x, end.y);
+    grid.set_next(x, end.y, cell);
+    grid.set_next(x, y, displaced);
   }
+
+  const std::uint64_t sinking = moves.straight & ~falling;
+
+  // clang-format off
+  apply_moves(grid, sinking,     x0, y,  0, y + 1, CellType::SAND, 0.0f);
+  apply_moves(grid, moves.left,  x0, y, -1, y + 1, CellType::SAND, 0.0f);
+  apply_moves(grid, moves.right, x0, y,  1, y + 1, CellType::SAND, 0.0f);
+  // clang-format on
 }
 
 /* <<<<<<<< STONE >>>>>>>> */
@@ -475,33 +694,4 @@ cell_data_t StoneCell::spawn(const position_t &pos, Grid &grid) noexcept {
   };
 }
 
-void StoneCell::step(const position_t &pos, Grid &grid) noexcept {
-  const auto [x, y] = pos;
-  const auto context = BaseCell::get_cell_context(pos, grid);
-}
-
-// void SandCell::step(const position_t &pos, Grid &grid) noexcept {
-//   const auto [x, y] = pos;
-//   const auto context = BaseCell::get_cell_context(pos, grid);
-//
-//   /* will flow down if possible */
-//   if (IS_FLUID(context.bottom)) {
-//     grid.set_next(x, y, { .type = CellType::AIR });
-//     grid.set_next(x, y + 1, { .type = CellType::SAND });
-//   }
-//
-//   /* else flow left if possible */
-//   else if (IS_FLUID(context.bottom_left)) {
-//     grid.set_next(x, y, { .type = CellType::AIR });
-//     grid.set_next(x - 1, y + 1, { .type = CellType::SAND });
-//   }
-//
-//   /* else flow right if possible */
-//   else if (IS_FLUID(context.bottom_right)) {
-//     grid.set_next(x, y, { .type = CellType::AIR });
-//     grid.set_next(x + 1, y + 1, { .type = CellType::SAND });
-//   }
-// }
-
-
 } /* namespace simulake */
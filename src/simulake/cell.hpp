@@ -2,11 +2,14 @@
 #define SIMULAKE_CELL_HPP
 
 #include <algorithm>
+#include <array>
 #include <cstdlib>
 #include <memory>
 #include <random>
 #include <utility>
 
+#include "random.hpp"
+
 namespace simulake {
 class Grid;
 
@@ -23,6 +26,24 @@ enum class CellType : std::uint8_t {
   STONE,
 };
 
+/* material properties of cell types, each kept as a bit plane by the cpu
+ * grid. ghost / out of bounds cells (NONE) have none of them */
+enum class Material : std::uint8_t {
+  EMPTY = 0, /* air */
+  FLUID,     /* liquid or gas */
+  LIQUID,
+  SOLID,     /* neither fluid nor out of bounds */
+  FLAMMABLE, /* non zero flammability */
+  COUNT,
+};
+
+/* how the cpu grid steps a cell type, see cell_dispatch_t */
+enum class Stepping : std::uint8_t {
+  NONE = 0, /* static, never steps (or has no rules) */
+  CELL,     /* per cell, Cell::step */
+  ROW,      /* a row word at a time, Cell::step_row */
+};
+
 struct cell_data_t {
   CellType type = CellType::NONE; /* type (NONE means out of bounds) */
   float mass = 0.0f;              /* current mass of the cell */
@@ -37,12 +58,54 @@ public:
   /* cell constants */
   static constexpr float gravity = 10.f;
 
+  /* fastest a cell moves, in cells per frame. the cpu grid lets rules
+   * reach less than half a chunk from the cell being stepped */
+  static constexpr float max_velocity = 31.f;
+
+  /* frames (at least 1) a cell may stay unchanged, with unchanged
+   * neighbors, before the cpu grid stops stepping it until a neighbor
+   * changes. only for rules that cannot act on an unchanged neighborhood
+   * (no random moves, no keep_awake), UINT8_MAX never sleeps */
+  static constexpr std::uint8_t sleep_after = UINT8_MAX;
+
   /* get cell type properties */
   static inline bool is_liquid(CellType);
   static inline bool is_gas(CellType);
   static inline bool is_fluid(CellType);
   static inline float flammability(CellType);
 
+  /* material bits of a cell type, bit i set iff it has Material i. keep in
+   * sync with the predicates above */
+  static constexpr std::uint8_t materials(CellType type) noexcept {
+    constexpr auto bit = [](Material m) {
+      return static_cast<std::uint8_t>(1 << static_cast<std::uint8_t>(m));
+    };
+
+    constexpr std::uint8_t gas = bit(Material::FLUID);
+    constexpr std::uint8_t liquid = gas | bit(Material::LIQUID);
+    constexpr std::uint8_t solid = bit(Material::SOLID);
+
+    switch (type) {
+    case CellType::AIR:
+      return gas | bit(Material::EMPTY);
+    case CellType::SMOKE:
+    case CellType::FIRE:
+      return gas;
+    case CellType::WATER:
+    case CellType::JET_FUEL:
+      return liquid;
+    case CellType::OIL:
+      return liquid | bit(Material::FLAMMABLE);
+    case CellType::SAND:
+      return solid | bit(Material::FLAMMABLE);
+    case CellType::GREEK_FIRE:
+    case CellType::STONE:
+      return solid;
+    default:
+      return 0; // CellType::NONE
+    };
+  }
+
   /* convenient packed representation of neighbors */
   struct __attribute__((packed)) context_t {
     // clang-format off
@@ -62,59 +125,79 @@ public:
   static inline context_t get_cell_context(const position_t &,
                                            const Grid &) noexcept;
 
-  static inline float random_float(float lower, float upper);
-  static inline int random_int(int lower, int upper);
+  /* draw from the cell's counter based stream, see Grid::rng_at */
+  static inline float random_float(rng_t &, float lower, float upper);
+  static inline int random_int(rng_t &, int lower, int upper);
 
 private:
   BaseCell() = delete;
-
-  static std::random_device rd;
-  static std::mt19937 gen;
 };
 
 /* air cell rules */
 struct AirCell final : public BaseCell {
+  static constexpr CellType type = CellType::AIR;
+  static constexpr Stepping stepping = Stepping::NONE;
+
   static cell_data_t spawn(const position_t &, Grid &) noexcept;
-  static void step(const position_t &, Grid &) noexcept;
 };
 
 /* smoke cell rules */
 struct SmokeCell final : public BaseCell {
+  static constexpr CellType type = CellType::SMOKE;
+  static constexpr Stepping stepping = Stepping::ROW;
+
   static cell_data_t spawn(const position_t &, Grid &) noexcept;
-  static void step(const position_t &, Grid &) noexcept;
+
+  /* word-wide rule for the smoke cells in [x_start, x_end) of row y,
+   * within one aligned 64 cell word. the cpu grid steps smoke only through
+   * this */
+  static void step_row(int, int, int, Grid &) noexcept;
 
   static constexpr float mass_decay = 0.005;
-  static std::vector<position_t> getEmptyTopNeighbors(const position_t &,
-                                                      Grid &) noexcept;
-  static std::vector<BaseCell::position_t>
-  getEmptyBottomNeighbors(const position_t &, Grid &) noexcept;
 };
 
 /* fire cell rules */
 struct FireCell final : public BaseCell {
+  static constexpr CellType type = CellType::FIRE;
+  static constexpr Stepping stepping = Stepping::CELL;
+
   static cell_data_t spawn(const position_t &, Grid &) noexcept;
   static void step(const position_t &, Grid &) noexcept;
 
   static constexpr float mass_decay = 0.05f;
-  static void helper(CellType curr, Grid &grid, int x, int y,
+  static void helper(CellType curr, Grid &grid, rng_t &rng, int x, int y,
                      float remaining_mass);
 };
 
-/* water cell rules */
-struct WaterCell final : public BaseCell {
+/* greek fire cell rules, like fire but never burns out */
+struct GreekFireCell final : public BaseCell {
+  static constexpr CellType type = CellType::GREEK_FIRE;
+  static constexpr Stepping stepping = Stepping::CELL;
+
   static cell_data_t spawn(const position_t &, Grid &) noexcept;
   static void step(const position_t &, Grid &) noexcept;
 
+  static constexpr float mass_decay = 0.05f;
+};
+
+/* mass flow shared by the liquids (water_step, oil_step in cell.cl), a row
+ * word at a time. a liquid flows down towards the stable state, levels out
+ * with its left and right neighbors and pushes compressed mass up. it only
+ * flows into its own type and into air or gases, which it displaces */
+struct LiquidCell : public BaseCell {
   static constexpr float max_mass = 1.0f;
-  static constexpr float max_compress = 0.02f;
-  static constexpr float min_mass = 0.001f;
+  static constexpr float max_compress = 0.01f;
+  static constexpr float min_mass = 0.001f; /* lighter cells evaporate */
   static constexpr float max_speed = 1.0f;
-  static constexpr float min_flow = 0.01f;
+  static constexpr float min_flow = 0.005f;
+  static constexpr float dampen = 0.75f;
+  static constexpr float settle_flow = 0.0001f; /* less is not levelled */
+  static constexpr int spread_passes = 4; /* levelling passes per step */
 
-  /* Returns the amount of water that should be in the bottom cell. */
-  static float get_stable_state_b(float total_mass) {
-    if (total_mass <= 1) {
-      return 1;
+  /* Returns the amount of liquid that should be in the bottom cell. */
+  static constexpr float get_stable_state_b(float total_mass) noexcept {
+    if (total_mass <= max_mass) {
+      return max_mass;
     } else if (total_mass < 2 * max_mass + max_compress) {
       return (max_mass * max_mass + total_mass * max_compress) /
              (max_mass + max_compress);
@@ -122,34 +205,157 @@ struct WaterCell final : public BaseCell {
       return (total_mass + max_compress) / 2;
     }
   }
+
+  /* flow the cells of the given liquid in [x_start, x_end) of row y, within
+   * one aligned 64 cell word */
+  static void flow_row(CellType, int, int, int, Grid &) noexcept;
+};
+
+/* water cell rules */
+struct WaterCell final : public LiquidCell {
+  static constexpr CellType type = CellType::WATER;
+  static constexpr Stepping stepping = Stepping::ROW;
+  static constexpr std::uint8_t sleep_after = 2; /* levelled water stays */
+
+  static cell_data_t spawn(const position_t &, Grid &) noexcept;
+
+  /* word-wide rule for the water cells in [x_start, x_end) of row y: sink
+   * below oil (water_oil_step in cell.cl), then flow_row */
+  static void step_row(int, int, int, Grid &) noexcept;
 };
 
 /* oil cell rules */
-struct OilCell final : public BaseCell {
+struct OilCell final : public LiquidCell {
+  static constexpr CellType type = CellType::OIL;
+  static constexpr Stepping stepping = Stepping::ROW;
+  static constexpr std::uint8_t sleep_after = 2; /* levelled oil stays */
+
+  static constexpr float spawn_mass = 0.8f;
+
   static cell_data_t spawn(const position_t &, Grid &) noexcept;
-  static void step(const position_t &, Grid &) noexcept;
+
+  /* word-wide rule for the oil cells in [x_start, x_end) of row y */
+  static void step_row(int, int, int, Grid &) noexcept;
 };
 
 /* sand cell rules */
 struct SandCell final : public BaseCell {
+  static constexpr CellType type = CellType::SAND;
+  static constexpr Stepping stepping = Stepping::ROW;
+  static constexpr std::uint8_t sleep_after = 2; /* blocked sand stays */
+
   static cell_data_t spawn(const position_t &, Grid &) noexcept;
-  static void step(const position_t &, Grid &) noexcept;
+
+  /* word-wide rule for the sand cells in [x_start, x_end) of row y, within
+   * one aligned 64 cell word. the cpu grid steps sand only through this */
+  static void step_row(int, int, int, Grid &) noexcept;
 
   static constexpr bool isFlammable = true;
 };
 
 /* jet fuel cell rules */
 struct JetFuelCell final : public BaseCell {
+  static constexpr CellType type = CellType::JET_FUEL;
+  static constexpr Stepping stepping = Stepping::CELL;
+
   static cell_data_t spawn(const position_t &, Grid &) noexcept;
   static void step(const position_t &, Grid &) noexcept;
 };
 
 /* stone cell rules */
 struct StoneCell final : public BaseCell {
+  static constexpr CellType type = CellType::STONE;
+  static constexpr Stepping stepping = Stepping::NONE;
+
   static cell_data_t spawn(const position_t &, Grid &) noexcept;
-  static void step(const position_t &, Grid &) noexcept;
 };
 
+/* typelist of cell rules */
+template <typename... Cells> struct cell_list_t {};
+
+/* cell rules of the cpu grid, adding a material is one entry here. row
+ * kernels run in this order */
+using cpu_cells_t =
+    cell_list_t<AirCell, SmokeCell, FireCell, GreekFireCell, WaterCell,
+                OilCell, SandCell, JetFuelCell, StoneCell>;
+
+/* compile time dispatch over a typelist of cell rules. the per type
+ * stepping and sleep tables let callers skip static types without a call,
+ * and the folds compile to a switch with the rule calls inlined */
+template <typename> struct cell_dispatch_t;
+
+template <typename... Cells> struct cell_dispatch_t<cell_list_t<Cells...>> {
+  static constexpr std::array<Stepping, 256> stepping = [] {
+    std::array<Stepping, 256> table{}; /* Stepping::NONE */
+    ((table[static_cast<std::size_t>(Cells::type)] = Cells::stepping), ...);
+    return table;
+  }();
+
+  static constexpr std::array<std::uint8_t, 256> sleep_after = [] {
+    std::array<std::uint8_t, 256> table;
+    table.fill(UINT8_MAX);
+    ((table[static_cast<std::size_t>(Cells::type)] = Cells::sleep_after), ...);
+    return table;
+  }();
+
+  static constexpr Stepping stepping_of(CellType type) noexcept {
+    return stepping[static_cast<std::size_t>(type)];
+  }
+
+  static constexpr std::uint8_t sleep_after_of(CellType type) noexcept {
+    return sleep_after[static_cast<std::size_t>(type)];
+  }
+
+  /* step a single cell of a Stepping::CELL type */
+  static inline void step(CellType type, const BaseCell::position_t &pos,
+                          Grid &grid) noexcept {
+    (void)((type == Cells::type and (step_if_cell<Cells>(pos, grid), true)) or
+           ...);
+  }
+
+  /* step all Stepping::ROW types over a row word, in typelist order */
+  static inline void step_row(int x_start, int x_end, int y,
+                              Grid &grid) noexcept {
+    (step_if_row<Cells>(x_start, x_end, y, grid), ...);
+  }
+
+  /* spawn a cell of given type, CellType::NONE if not listed */
+  static inline cell_data_t spawn(CellType type,
+                                  const BaseCell::position_t &pos,
+                                  Grid &grid) noexcept {
+    cell_data_t cell;
+    (void)((type == Cells::type and (cell = Cells::spawn(pos, grid), true)) or
+           ...);
+    return cell;
+  }
+
+  /* call f.template operator()<Cell>() once, for the rule of given type
+   * (nothing if not listed). hoists the type dispatch out of loops over
+   * cells of a single type, see Grid::paint_cells */
+  template <typename F>
+  static inline void visit(CellType type, F &&f) noexcept {
+    (void)((type == Cells::type and (f.template operator()<Cells>(), true)) or
+           ...);
+  }
+
+private:
+  template <typename Cell>
+  static inline void step_if_cell(const BaseCell::position_t &pos,
+                                  Grid &grid) noexcept {
+    if constexpr (Cell::stepping == Stepping::CELL)
+      Cell::step(pos, grid);
+  }
+
+  template <typename Cell>
+  static inline void step_if_row(int x_start, int x_end, int y,
+                                 Grid &grid) noexcept {
+    if constexpr (Cell::stepping == Stepping::ROW)
+      Cell::step_row(x_start, x_end, y, grid);
+  }
+};
+
+using cpu_dispatch_t = cell_dispatch_t<cpu_cells_t>;
+
 } /* namespace simulake */
 
 #endif
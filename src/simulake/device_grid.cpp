@@ -1,32 +1,172 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 
+#ifndef __APPLE__
+#include <dlfcn.h>
+#endif
+
 #include "device_grid.hpp"
 
+/* NOTE(vir): same plane offsets as the opencl kernels */
+#include "layout.cl"
+
 namespace simulake {
+std::vector<DeviceGrid::device_info_t> DeviceGrid::list_devices() noexcept {
+  std::vector<device_info_t> devices;
+
+  // NOTE(vir): no platform (e.g. a bare icd loader) is not an error here
+  cl_uint num_platforms = 0;
+  if (clGetPlatformIDs(0, nullptr, &num_platforms) != CL_SUCCESS)
+    return devices;
+
+  std::vector<cl_platform_id> platforms(num_platforms);
+  CL_CALL(clGetPlatformIDs(num_platforms, platforms.data(), nullptr));
+
+  const auto info_string = [](auto get_info, auto object, auto param) {
+    size_t size = 0;
+    CL_CALL(get_info(object, param, 0, nullptr, &size));
+
+    std::string value(size, '\0');
+    CL_CALL(get_info(object, param, size, value.data(), nullptr));
+    value.resize(value.find('\0') == std::string::npos ? size
+                                                       : value.find('\0'));
+    return value;
+  };
+
+  for (const auto platform : platforms) {
+    cl_uint num_devices = 0;
+    if (clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, 0, nullptr,
+                       &num_devices) != CL_SUCCESS)
+      continue;
+
+    std::vector<cl_device_id> ids(num_devices);
+    CL_CALL(clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, num_devices,
+                           ids.data(), nullptr));
+
+    const auto platform_name =
+        info_string(clGetPlatformInfo, platform, CL_PLATFORM_NAME);
+
+    for (const auto device : ids) {
+      device_info_t info{.platform = platform,
+                         .device = device,
+                         .platform_name = platform_name,
+                         .device_name = info_string(clGetDeviceInfo, device,
+                                                    CL_DEVICE_NAME)};
+      CL_CALL(clGetDeviceInfo(device, CL_DEVICE_TYPE, sizeof(cl_device_type),
+                              &info.type, nullptr));
+      devices.push_back(std::move(info));
+    }
+  }
+
+  return devices;
+}
+
+std::optional<DeviceGrid::device_info_t>
+DeviceGrid::select_device(const device_options_t &options) noexcept {
+  const auto lower = [](std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return text;
+  };
+
+  const auto name = lower(options.name);
+  const auto matches = [&](const device_info_t &info) {
+    return (info.type & options.type) != 0 and
+           (name.empty() or
+            lower(info.device_name).find(name) != std::string::npos or
+            lower(info.platform_name).find(name) != std::string::npos);
+  };
+
+  const auto devices = list_devices();
+  if (options.index.has_value()) {
+    if (*options.index < devices.size() and matches(devices[*options.index]))
+      return devices[*options.index];
+    return std::nullopt;
+  }
+
+  for (const cl_device_type preferred :
+       {cl_device_type{CL_DEVICE_TYPE_GPU}, cl_device_type{CL_DEVICE_TYPE_CPU},
+        cl_device_type{CL_DEVICE_TYPE_ALL}}) {
+    for (const auto &info : devices) {
+      if ((info.type & preferred) != 0 and matches(info))
+        return info;
+    }
+  }
+
+  return std::nullopt;
+}
+
+DeviceGrid::device_options_t
+DeviceGrid::parse_device_spec(const std::string_view spec) noexcept {
+  if (spec == "gpu")
+    return {.type = CL_DEVICE_TYPE_GPU};
+  if (spec == "cpu")
+    return {.type = CL_DEVICE_TYPE_CPU};
+  if (spec == "accelerator")
+    return {.type = CL_DEVICE_TYPE_ACCELERATOR};
+  if (spec.empty() or spec == "any")
+    return {};
+
+  std::uint32_t index = 0;
+  const auto [end, error] =
+      std::from_chars(spec.data(), spec.data() + spec.size(), index);
+  if (error == std::errc{} and end == spec.data() + spec.size())
+    return {.index = index};
+
+  return {.name = std::string(spec)};
+}
+
+std::unique_ptr<DeviceGrid>
+DeviceGrid::create(const std::uint32_t width, const std::uint32_t height,
+                   const std::uint32_t cell_size,
+                   const device_options_t &options, const Layout layout) {
+  const auto device = select_device(options);
+  if (!device.has_value()) {
+    std::cerr << "ERROR::DEVICE_GRID: no opencl device matches" << std::endl;
+    return nullptr;
+  }
+
+  std::cout << "opencl device: " << device->device_name << " ("
+            << device->platform_name << ")" << std::endl;
+  return std::make_unique<DeviceGrid>(width, height, cell_size, *device,
+                                      layout);
+}
+
 DeviceGrid::DeviceGrid(const std::uint32_t _width, const std::uint32_t _height,
-                       const std::uint32_t _cell_size)
-    : flip_flag(true), width(_width), height(_height), cell_size(_cell_size) {
+                       const std::uint32_t _cell_size,
+                       const device_info_t &device, const Layout _layout)
+    : layout(_layout), flip_flag(true), width(_width), height(_height),
+      cell_size(_cell_size) {
   num_cells = width * height;
-  memory_size = num_cells * sizeof(device_cell_t);
+  memory_size = layout == Layout::CELLS ? num_cells * sizeof(device_cell_t)
+                                        : grid_planes_size(num_cells);
 
-  initialize_device();
+  initialize_device(device);
   initialize_kernels();
   reset();
 }
 
 DeviceGrid::~DeviceGrid() {
+  release_texture_target();
+
   CL_CALL(clReleaseMemObject(sim_context.grid));
   CL_CALL(clReleaseMemObject(sim_context.next_grid));
-  CL_CALL(clReleaseMemObject(sim_context.seeds));
+  CL_CALL(clReleaseMemObject(sim_context.paint_mask));
+  CL_CALL(clReleaseMemObject(sim_context.tile_steps));
   CL_CALL(clReleaseKernel(sim_context.init_kernel));
   CL_CALL(clReleaseKernel(sim_context.sim_kernel));
   CL_CALL(clReleaseKernel(sim_context.fluid_kernel));
   CL_CALL(clReleaseKernel(sim_context.rand_kernel));
   CL_CALL(clReleaseKernel(sim_context.render_kernel));
   CL_CALL(clReleaseKernel(sim_context.spawn_kernel));
+  CL_CALL(clReleaseKernel(sim_context.paint_kernel));
+  CL_CALL(clReleaseKernel(sim_context.carry_kernel));
+  CL_CALL(clReleaseKernel(sim_context.texels_kernel));
   CL_CALL(clReleaseProgram(sim_context.program));
   CL_CALL(clReleaseCommandQueue(sim_context.queue));
   CL_CALL(clReleaseContext(sim_context.context));
@@ -37,27 +177,18 @@ void DeviceGrid::reset() noexcept {
   const size_t global_item_size[] = {width, height};
   const size_t local_item_size[] = {LOCAL_WIDTH, LOCAL_HEIGHT};
 
+  // reset seed
+  {
+    std::random_device rd;
+    seed = (static_cast<std::uint64_t>(rd()) << 32) | rd();
+    frame = 0;
+  }
+
+  set_rng_key(sim_context.init_kernel);
   CL_CALL(clEnqueueNDRangeKernel(sim_context.queue, sim_context.init_kernel, 2,
                                  nullptr, global_item_size, local_item_size, 0,
                                  nullptr, nullptr));
 
-  // reset seeds
-  {
-    static std::uniform_int_distribution<unsigned long> distribution(
-        std::numeric_limits<unsigned long>::min(),
-        std::numeric_limits<unsigned long>::max());
-    static std::default_random_engine generator{};
-
-    // generate seeds
-    std::vector<unsigned long> seeds(num_cells, 0L);
-    std::generate(seeds.begin(), seeds.end(),
-                  []() { return distribution(generator); });
-
-    CL_CALL(clEnqueueWriteBuffer(sim_context.queue, sim_context.seeds, CL_TRUE,
-                                 0, num_cells * sizeof(unsigned long),
-                                 seeds.data(), 0, nullptr, nullptr));
-  }
-
   // wait for kernel to finish
   CL_CALL(clFinish(sim_context.queue));
 }
@@ -67,6 +198,7 @@ void DeviceGrid::initialize_random() const noexcept {
   const size_t global_item_size[] = {width, height};
   const size_t local_item_size[] = {LOCAL_WIDTH, LOCAL_HEIGHT};
 
+  set_rng_key(sim_context.rand_kernel);
   CL_CALL(clEnqueueNDRangeKernel(sim_context.queue, sim_context.rand_kernel, 2,
                                  nullptr, global_item_size, local_item_size, 0,
                                  nullptr, nullptr));
@@ -82,11 +214,37 @@ void DeviceGrid::simulate(float delta_time) noexcept {
   const size_t global_item_size[] = {width, height};
   const size_t local_item_size[] = {LOCAL_WIDTH, LOCAL_HEIGHT};
 
+  frame += 1;
+  set_rng_key(sim_context.sim_kernel);
+  set_rng_key(sim_context.fluid_kernel, RNG_FLUID_STREAM);
+
+  // NOTE(vir): a step only writes the next grid around moving cells, the rest
+  // of it still holds the state from before the previous step. bring the
+  // tiles the previous step touched up to date, so both grids are equal again
+  // without copying all of it. there is nothing to carry after a reset
+  if (frame > 1) {
+    const cl_uint last_step = frame - 1;
+
+    // clang-format off
+    CL_CALL(clSetKernelArg(sim_context.carry_kernel, 0, sizeof(cl_mem), &current_grid()));
+    CL_CALL(clSetKernelArg(sim_context.carry_kernel, 1, sizeof(cl_mem), &other_grid()));
+    CL_CALL(clSetKernelArg(sim_context.carry_kernel, 4, sizeof(cl_uint), &last_step));
+    // clang-format on
+
+    CL_CALL(clEnqueueNDRangeKernel(sim_context.queue, sim_context.carry_kernel,
+                                   2, nullptr, global_item_size,
+                                   local_item_size, 0, nullptr, nullptr));
+  }
+
+  const cl_uint step = frame;
+
   // clang-format off
-  CL_CALL(clSetKernelArg(sim_context.sim_kernel, flip_flag ? 1 : 2, sizeof(cl_mem), &sim_context.grid));
-  CL_CALL(clSetKernelArg(sim_context.sim_kernel, flip_flag ? 2 : 1, sizeof(cl_mem), &sim_context.next_grid));
-  CL_CALL(clSetKernelArg(sim_context.fluid_kernel, flip_flag ? 1 : 2, sizeof(cl_mem), &sim_context.grid));
-  CL_CALL(clSetKernelArg(sim_context.fluid_kernel, flip_flag ? 2 : 1, sizeof(cl_mem), &sim_context.next_grid));
+  CL_CALL(clSetKernelArg(sim_context.sim_kernel, 1, sizeof(cl_mem), &current_grid()));
+  CL_CALL(clSetKernelArg(sim_context.sim_kernel, 2, sizeof(cl_mem), &other_grid()));
+  CL_CALL(clSetKernelArg(sim_context.sim_kernel, 5, sizeof(cl_uint), &step));
+  CL_CALL(clSetKernelArg(sim_context.fluid_kernel, 1, sizeof(cl_mem), &current_grid()));
+  CL_CALL(clSetKernelArg(sim_context.fluid_kernel, 2, sizeof(cl_mem), &other_grid()));
+  CL_CALL(clSetKernelArg(sim_context.fluid_kernel, 5, sizeof(cl_uint), &step));
   // clang-format on
 
   CL_CALL(clEnqueueNDRangeKernel(sim_context.queue, sim_context.sim_kernel, 2,
@@ -97,29 +255,32 @@ void DeviceGrid::simulate(float delta_time) noexcept {
                                  nullptr, global_item_size, local_item_size, 0,
                                  nullptr, nullptr));
 
-  CL_CALL(clEnqueueCopyBuffer(
-      sim_context.queue, flip_flag ? sim_context.next_grid : sim_context.grid,
-      flip_flag ? sim_context.grid : sim_context.next_grid, 0, 0, memory_size,
-      0, nullptr, nullptr));
+  // the grid just written is current now
+  flip_flag = !flip_flag;
 
   render_texture();
 
+  // NOTE(vir): gl may only draw from a shared texture once the queue has
+  // finished. texels read back are waited for one step later instead, so
+  // only submit the queue and upload the previous step's texels while this
+  // step runs
+  if (sim_context.texels != nullptr) {
+    CL_CALL(clFlush(sim_context.queue));
+    upload_texture();
+    return;
+  }
+
   // wait for kernels to finish
   CL_CALL(clFinish(sim_context.queue));
-
-  flip_flag = !flip_flag;
 }
 
-GridBase::serialized_grid_t DeviceGrid::serialize() const noexcept {
-  std::vector<device_cell_t> grid(num_cells);
-
-  CL_CALL(clEnqueueReadBuffer(
-      sim_context.queue, flip_flag ? sim_context.grid : sim_context.next_grid,
-      CL_TRUE, 0, memory_size, grid.data(), 0, nullptr, nullptr));
-  CL_CALL(clFinish(sim_context.queue));
+void DeviceGrid::serialize_into(
+    GridBase::serialized_grid_t &data) const noexcept {
+  const auto grid = read_cells(current_grid());
 
   // convert in array of floats
-  std::vector<float> out_buf(num_cells * NUM_FLOATS, 0.0f);
+  auto &out_buf = data.buffer;
+  out_buf.assign(num_cells * NUM_FLOATS, 0.0f);
   for (int i = 0; i < num_cells; i += 1) {
     const auto out_idx = i * NUM_FLOATS;
     out_buf[out_idx + 0] = static_cast<float>(grid[i].type);
@@ -128,7 +289,9 @@ GridBase::serialized_grid_t DeviceGrid::serialize() const noexcept {
     out_buf[out_idx + 3] = static_cast<float>(grid[i].velocity.s[1]);
   }
 
-  return {get_width(), get_height(), NUM_FLOATS, std::move(out_buf)};
+  data.width = get_width();
+  data.height = get_height();
+  data.stride = NUM_FLOATS;
 }
 
 void DeviceGrid::deserialize(const GridBase::serialized_grid_t &data) noexcept {
@@ -152,86 +315,296 @@ void DeviceGrid::deserialize(const GridBase::serialized_grid_t &data) noexcept {
     grid[in_idx].velocity.s[1] = static_cast<cl_float>(data.buffer[idx + 3]);
   }
 
-  CL_CALL(clEnqueueWriteBuffer(sim_context.queue, sim_context.grid, CL_TRUE, 0,
-                               memory_size, grid.data(), 0, nullptr, nullptr));
-  CL_CALL(clEnqueueCopyBuffer(sim_context.queue, sim_context.grid,
-                              sim_context.next_grid, 0, 0, memory_size, 0,
-                              nullptr, nullptr));
+  // both grids hold the loaded state, like after a reset
+  write_cells(grid);
 }
 
-void DeviceGrid::render_texture() const noexcept {
+void DeviceGrid::render_texture() noexcept {
   const size_t global_item_size[] = {width, height};
   const size_t local_item_size[] = {LOCAL_WIDTH, LOCAL_HEIGHT};
-
-  // NOTE(vir):
-  // - image is CL_MEM_OBJECT_IMAGE2D;
-  // - image format and datatype what texture was initialized to
-  // - eg: with stride = 2, format = CL_RG (2 channels), type = CL_FLOAT
   cl_int error = CL_SUCCESS;
-  cl_image image =
-      clCreateFromGLTexture(sim_context.context, CL_MEM_WRITE_ONLY,
-                            GL_TEXTURE_2D, 0, texture_target, &error);
-  CL_CALL(error);
 
-#if DEBUG
-  // show only once
-  const static bool _ = [this, &image]() {
-    print_cl_image_debug_info(image);
-    return true;
-  }();
-#endif
+  // NOTE(vir): without gl sharing, render texels and start reading them back
+  // into the next slot. the read lands in the slot's pixel buffer mapped by
+  // gl where mapping works, the next upload_texture waits for it
+  if (sim_context.texels != nullptr) {
+    const size_t texels_size = num_cells * sizeof(cl_float2);
+    texels_slot_t &slot = sim_context.texels_slots[sim_context.texels_slot];
+    sim_context.texels_slot = (sim_context.texels_slot + 1) % TEXELS_SLOTS;
+
+    // orphan the pixel buffer, so mapping it never waits for gl to be done
+    // with the slot's last upload
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, texels_size, nullptr, GL_STREAM_DRAW);
+    slot.pixels =
+        glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, texels_size,
+                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    void *target = slot.pixels;
+    if (target == nullptr) {
+      slot.fallback.resize(num_cells);
+      target = slot.fallback.data();
+    }
+
+    // clang-format off
+    CL_CALL(clSetKernelArg(sim_context.texels_kernel, 1, sizeof(cl_mem), &current_grid()));
+    // clang-format on
 
-  // NOTE(vir): no need to call clEnqueueAcquireGLObjects
+    CL_CALL(clEnqueueNDRangeKernel(sim_context.queue, sim_context.texels_kernel,
+                                   2, nullptr, global_item_size,
+                                   local_item_size, 0, nullptr, nullptr));
+
+    CL_CALL(clEnqueueReadBuffer(sim_context.queue, sim_context.texels,
+                                CL_FALSE, 0, texels_size, target, 0, nullptr,
+                                &slot.read));
+    return;
+  }
+
+  if (sim_context.texture_image == nullptr)
+    return;
+
+  // the last fence is signalled, simulate waits for the queue to finish
+  if (sim_context.gl_fence != nullptr) {
+    glDeleteSync(sim_context.gl_fence);
+    sim_context.gl_fence = nullptr;
+  }
+
+  // NOTE(vir): gl has to be done drawing from the texture before cl writes
+  // it. with cl_khr_gl_event the acquire waits on a gl fence on the device,
+  // otherwise the host waits for gl
+  cl_event gl_done = nullptr;
+  if (sim_context.create_gl_sync_event != nullptr) {
+    sim_context.gl_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    gl_done = sim_context.create_gl_sync_event(
+        sim_context.context, sim_context.gl_fence, &error);
+    CL_CALL(error);
+  } else {
+    glFinish();
+  }
 
   // clang-format off
-  // TODO(vir): do we need both current and previous frame? might be useful for effects
-  CL_CALL(clSetKernelArg(sim_context.render_kernel, 1, sizeof(cl_image), &image));
-  CL_CALL(clSetKernelArg(sim_context.render_kernel, flip_flag ? 3 : 2, sizeof(cl_mem), &sim_context.grid));
-  CL_CALL(clSetKernelArg(sim_context.render_kernel, flip_flag ? 2 : 3, sizeof(cl_mem), &sim_context.next_grid));
+  CL_CALL(clEnqueueAcquireGLObjects(sim_context.queue, 1, &sim_context.texture_image, gl_done != nullptr ? 1 : 0, gl_done != nullptr ? &gl_done : nullptr, nullptr));
+
+  CL_CALL(clSetKernelArg(sim_context.render_kernel, 1, sizeof(cl_image), &sim_context.texture_image));
+  CL_CALL(clSetKernelArg(sim_context.render_kernel, 2, sizeof(cl_mem), &current_grid()));
   // clang-format on
 
   // render into texture
   CL_CALL(clEnqueueNDRangeKernel(sim_context.queue, sim_context.render_kernel,
                                  2, nullptr, global_item_size, local_item_size,
                                  0, nullptr, nullptr));
+
+  // NOTE(vir): gl may draw from the texture once the queue has finished,
+  // which simulate waits for
+  CL_CALL(clEnqueueReleaseGLObjects(sim_context.queue, 1,
+                                    &sim_context.texture_image, 0, nullptr,
+                                    nullptr));
+
+  if (gl_done != nullptr)
+    CL_CALL(clReleaseEvent(gl_done));
+}
+
+void DeviceGrid::upload_texture() noexcept {
+  // the slot read into before the one render_texture just started
+  texels_slot_t &slot =
+      sim_context.texels_slots[(sim_context.texels_slot + TEXELS_SLOTS - 2) %
+                               TEXELS_SLOTS];
+  if (slot.read == nullptr)
+    return;
+
+  CL_CALL(clWaitForEvents(1, &slot.read));
+  CL_CALL(clReleaseEvent(slot.read));
+  slot.read = nullptr;
+
+  // NOTE(vir): gl moves the pixel buffer into the texture on its own time.
+  // a buffer that lost its contents while mapped skips this upload
+  glBindTexture(GL_TEXTURE_2D, texture_target);
+  if (slot.pixels != nullptr) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+    slot.pixels = nullptr;
+
+    if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE)
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RG, GL_FLOAT,
+                      nullptr);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  } else {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RG, GL_FLOAT,
+                    slot.fallback.data());
+  }
+}
+
+void DeviceGrid::set_rng_key(cl_kernel kernel,
+                             cl_ulong stream) const noexcept {
+  const cl_ulong key = rng_frame_key(seed, frame) + stream;
+  CL_CALL(clSetKernelArg(kernel, 0, sizeof(cl_ulong), &key));
 }
 
 void DeviceGrid::set_texture_target(const GLuint target) noexcept {
+  // NOTE(vir): the renderer calls this after (re)allocating the texture, the
+  // old render target no longer matches its storage
+  release_texture_target();
   texture_target = target;
+
+  cl_int error = CL_SUCCESS;
+
+  if (gl_sharing) {
+    // NOTE(vir):
+    // - image is CL_MEM_OBJECT_IMAGE2D;
+    // - image format and datatype what texture was initialized to
+    // - eg: with stride = 2, format = CL_RG (2 channels), type = CL_FLOAT
+    // - created once per texture, acquired for each render_texture
+    sim_context.texture_image =
+        clCreateFromGLTexture(sim_context.context, CL_MEM_WRITE_ONLY,
+                              GL_TEXTURE_2D, 0, texture_target, &error);
+    CL_CALL(error);
+
+#if DEBUG
+    print_cl_image_debug_info(sim_context.texture_image);
+#endif
+    return;
+  }
+
+  // NOTE(vir): without sharing the texels kernel renders into a device
+  // buffer laid out like the texture (GL_RG32F), which is read back into
+  // one of two pixel buffers and uploaded from there a step later
+  const size_t texels_size = num_cells * sizeof(cl_float2);
+
+  // clang-format off
+  sim_context.texels = clCreateBuffer(sim_context.context, CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY, texels_size, nullptr, &error);
+  CL_CALL(error);
+
+  CL_CALL(clSetKernelArg(sim_context.texels_kernel, 0, sizeof(cl_mem), &sim_context.texels));
+  // clang-format on
+
+  sim_context.texels_slot = 0;
+  for (texels_slot_t &slot : sim_context.texels_slots)
+    glGenBuffers(1, &slot.pbo);
+}
+
+void DeviceGrid::release_texture_target() noexcept {
+  if (sim_context.gl_fence != nullptr) {
+    glDeleteSync(sim_context.gl_fence);
+    sim_context.gl_fence = nullptr;
+  }
+
+  if (sim_context.texture_image != nullptr) {
+    CL_CALL(clReleaseMemObject(sim_context.texture_image));
+    sim_context.texture_image = nullptr;
+  }
+
+  // reads in flight still write into their slot
+  for (texels_slot_t &slot : sim_context.texels_slots) {
+    if (slot.read != nullptr) {
+      CL_CALL(clWaitForEvents(1, &slot.read));
+      CL_CALL(clReleaseEvent(slot.read));
+      slot.read = nullptr;
+    }
+
+    if (slot.pixels != nullptr) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      slot.pixels = nullptr;
+    }
+
+    if (slot.pbo != 0) {
+      glDeleteBuffers(1, &slot.pbo);
+      slot.pbo = 0;
+    }
+
+    slot.fallback = {};
+  }
+
+  if (sim_context.texels != nullptr) {
+    CL_CALL(clReleaseMemObject(sim_context.texels));
+    sim_context.texels = nullptr;
+  }
 }
 
 void DeviceGrid::spawn_cells(
     const std::tuple<std::uint32_t, std::uint32_t> &center,
     const std::uint32_t paint_radius, const CellType paint_target) noexcept {
 
-  const size_t global_item_size[] = {width, height};
-  const size_t local_item_size[] = {LOCAL_WIDTH, LOCAL_HEIGHT};
+  const int x = static_cast<int>(std::get<0>(center));
+  const int y = static_cast<int>(std::get<1>(center));
+  const int r = static_cast<int>(paint_radius);
+
+  // launch over the disc's bounding box only, clipped to the grid
+  const int x_start = std::max(x - r, 0);
+  const int y_start = std::max(y - r, 0);
+  const int x_end = std::min(x + r + 1, static_cast<int>(width));
+  const int y_end = std::min(y + r + 1, static_cast<int>(height));
+  if (x_start >= x_end or y_start >= y_end)
+    return;
+
+  const size_t global_item_offset[] = {static_cast<size_t>(x_start),
+                                       static_cast<size_t>(y_start)};
+  const size_t global_item_size[] = {static_cast<size_t>(x_end - x_start),
+                                     static_cast<size_t>(y_end - y_start)};
   const auto radius = static_cast<unsigned int>(paint_radius);
   const auto target = static_cast<unsigned int>(paint_target);
-  const cl_uint2 grid_xy = {static_cast<unsigned int>(std::get<0>(center)),
-                            static_cast<unsigned int>(std::get<1>(center))};
+  const cl_uint2 grid_xy = {static_cast<unsigned int>(x),
+                            static_cast<unsigned int>(y)};
+
+  // spawn draws come from their own stream, apart from the step draws
+  const cl_ulong key = rng_frame_key(seed, frame) + RNG_SPAWN_STREAM;
 
   // update the last rendered grid, do not overwrite existing non-vacant cells
   // clang-format off
-  CL_CALL(clSetKernelArg(sim_context.spawn_kernel, flip_flag ? 1 : 2, sizeof(cl_mem), &sim_context.grid));
-  CL_CALL(clSetKernelArg(sim_context.spawn_kernel, flip_flag ? 2 : 1, sizeof(cl_mem), &sim_context.next_grid));
+  CL_CALL(clSetKernelArg(sim_context.spawn_kernel, 0, sizeof(cl_ulong), &key));
+  CL_CALL(clSetKernelArg(sim_context.spawn_kernel, 1, sizeof(cl_mem), &current_grid()));
+  CL_CALL(clSetKernelArg(sim_context.spawn_kernel, 2, sizeof(cl_mem), &other_grid()));
   CL_CALL(clSetKernelArg(sim_context.spawn_kernel, 3, sizeof(cl_uint2), &grid_xy));
   CL_CALL(clSetKernelArg(sim_context.spawn_kernel, 4, sizeof(unsigned int), &radius));
   CL_CALL(clSetKernelArg(sim_context.spawn_kernel, 5, sizeof(unsigned int), &target));
   // clang-format on
 
   CL_CALL(clEnqueueNDRangeKernel(sim_context.queue, sim_context.spawn_kernel, 2,
-                                 nullptr, global_item_size, local_item_size, 0,
+                                 global_item_offset, global_item_size, nullptr,
+                                 0, nullptr, nullptr));
+}
+
+void DeviceGrid::paint_cells(const paint_mask_t &mask) noexcept {
+  if (mask.width == 0 or mask.height == 0)
+    return;
+
+  // only the mask's box is launched, the runtime picks the work group size
+  const size_t global_item_size[] = {mask.width, mask.height};
+  const auto target = static_cast<unsigned int>(mask.target);
+  const cl_uint2 origin = {mask.x, mask.y};
+
+  // spawn draws come from their own stream, apart from the step draws
+  const cl_ulong key = rng_frame_key(seed, frame) + RNG_SPAWN_STREAM;
+
+  // expand spans to a coverage byte per cell of the box
+  paint_coverage.assign(mask.width * mask.height, 0);
+  for (const auto &span : mask.spans) {
+    std::memset(&paint_coverage[(span.y - mask.y) * mask.width +
+                                (span.x_begin - mask.x)],
+                1, span.x_end - span.x_begin);
+  }
+
+  CL_CALL(clEnqueueWriteBuffer(sim_context.queue, sim_context.paint_mask,
+                               CL_TRUE, 0, paint_coverage.size(),
+                               paint_coverage.data(), 0, nullptr, nullptr));
+
+  // clang-format off
+  CL_CALL(clSetKernelArg(sim_context.paint_kernel, 0, sizeof(cl_ulong), &key));
+  CL_CALL(clSetKernelArg(sim_context.paint_kernel, 1, sizeof(cl_mem), &current_grid()));
+  CL_CALL(clSetKernelArg(sim_context.paint_kernel, 2, sizeof(cl_mem), &other_grid()));
+  CL_CALL(clSetKernelArg(sim_context.paint_kernel, 4, sizeof(cl_uint2), &origin));
+  CL_CALL(clSetKernelArg(sim_context.paint_kernel, 5, sizeof(unsigned int), &target));
+  // clang-format on
+
+  CL_CALL(clEnqueueNDRangeKernel(sim_context.queue, sim_context.paint_kernel, 2,
+                                 nullptr, global_item_size, nullptr, 0,
                                  nullptr, nullptr));
 }
 
 void DeviceGrid::print_current() const noexcept {
-  std::vector<device_cell_t> grid(num_cells);
-
-  CL_CALL(clEnqueueReadBuffer(
-      sim_context.queue, flip_flag ? sim_context.grid : sim_context.next_grid,
-      CL_TRUE, 0, memory_size, grid.data(), 0, nullptr, nullptr));
-  CL_CALL(clFinish(sim_context.queue));
+  const auto grid = read_cells(current_grid());
 
   for (int row = 0; row < height; row += 1) {
     for (int col = 0; col < width; col += 1) {
@@ -245,16 +618,9 @@ void DeviceGrid::print_current() const noexcept {
 }
 
 void DeviceGrid::print_both() const noexcept {
-  std::vector<device_cell_t> grid(num_cells);
-  std::vector<device_cell_t> next_grid(num_cells);
-
   // copy data device -> cpu
-  // clang-format off
-  CL_CALL(clEnqueueReadBuffer(sim_context.queue, sim_context.grid, CL_TRUE, 0, memory_size, grid.data(), 0, nullptr, nullptr));
-  CL_CALL(clEnqueueReadBuffer(sim_context.queue, sim_context.next_grid, CL_TRUE, 0, memory_size, next_grid.data(), 0, nullptr, nullptr));
-  // clang-format on
-
-  CL_CALL(clFinish(sim_context.queue));
+  const auto grid = read_cells(sim_context.grid);
+  const auto next_grid = read_cells(sim_context.next_grid);
 
   for (int row = 0; row < height; row += 1) {
     for (int col = 0; col < width; col += 1) {
@@ -275,6 +641,81 @@ void DeviceGrid::print_both() const noexcept {
   std::cout << "---\n";
 }
 
+std::vector<DeviceGrid::device_cell_t>
+DeviceGrid::read_cells(const cl_mem buffer) const noexcept {
+  std::vector<device_cell_t> cells(num_cells);
+
+  if (layout == Layout::CELLS) {
+    CL_CALL(clEnqueueReadBuffer(sim_context.queue, buffer, CL_TRUE, 0,
+                                memory_size, cells.data(), 0, nullptr,
+                                nullptr));
+    return cells;
+  }
+
+  std::vector<CellType> type(num_cells);
+  std::vector<cl_float> mass(num_cells);
+  std::vector<cl_float2> velocity(num_cells);
+  std::vector<cl_uchar> updated(num_cells);
+
+  // NOTE(vir): the queue is in order, the last (blocking) read returns once
+  // all planes are in
+  // clang-format off
+  CL_CALL(clEnqueueReadBuffer(sim_context.queue, buffer, CL_FALSE, 0, num_cells * sizeof(CellType), type.data(), 0, nullptr, nullptr));
+  CL_CALL(clEnqueueReadBuffer(sim_context.queue, buffer, CL_FALSE, grid_mass_offset(num_cells), num_cells * sizeof(cl_float), mass.data(), 0, nullptr, nullptr));
+  CL_CALL(clEnqueueReadBuffer(sim_context.queue, buffer, CL_FALSE, grid_velocity_offset(num_cells), num_cells * sizeof(cl_float2), velocity.data(), 0, nullptr, nullptr));
+  CL_CALL(clEnqueueReadBuffer(sim_context.queue, buffer, CL_TRUE, grid_updated_offset(num_cells), num_cells * sizeof(cl_uchar), updated.data(), 0, nullptr, nullptr));
+  // clang-format on
+
+  for (std::uint32_t i = 0; i < num_cells; i += 1) {
+    cells[i].type = type[i];
+    cells[i].mass = mass[i];
+    cells[i].velocity = velocity[i];
+    cells[i].updated = updated[i] != 0;
+  }
+
+  return cells;
+}
+
+void DeviceGrid::write_cells(
+    const std::vector<device_cell_t> &cells) noexcept {
+  const cl_mem buffers[] = {sim_context.grid, sim_context.next_grid};
+
+  if (layout == Layout::CELLS) {
+    for (const cl_mem buffer : buffers) {
+      CL_CALL(clEnqueueWriteBuffer(sim_context.queue, buffer, CL_FALSE, 0,
+                                   memory_size, cells.data(), 0, nullptr,
+                                   nullptr));
+    }
+
+    CL_CALL(clFinish(sim_context.queue));
+    return;
+  }
+
+  std::vector<CellType> type(num_cells);
+  std::vector<cl_float> mass(num_cells);
+  std::vector<cl_float2> velocity(num_cells);
+  std::vector<cl_uchar> updated(num_cells);
+
+  for (std::uint32_t i = 0; i < num_cells; i += 1) {
+    type[i] = cells[i].type;
+    mass[i] = cells[i].mass;
+    velocity[i] = cells[i].velocity;
+    updated[i] = cells[i].updated;
+  }
+
+  for (const cl_mem buffer : buffers) {
+    // clang-format off
+    CL_CALL(clEnqueueWriteBuffer(sim_context.queue, buffer, CL_FALSE, 0, num_cells * sizeof(CellType), type.data(), 0, nullptr, nullptr));
+    CL_CALL(clEnqueueWriteBuffer(sim_context.queue, buffer, CL_FALSE, grid_mass_offset(num_cells), num_cells * sizeof(cl_float), mass.data(), 0, nullptr, nullptr));
+    CL_CALL(clEnqueueWriteBuffer(sim_context.queue, buffer, CL_FALSE, grid_velocity_offset(num_cells), num_cells * sizeof(cl_float2), velocity.data(), 0, nullptr, nullptr));
+    CL_CALL(clEnqueueWriteBuffer(sim_context.queue, buffer, CL_FALSE, grid_updated_offset(num_cells), num_cells * sizeof(cl_uchar), updated.data(), 0, nullptr, nullptr));
+    // clang-format on
+  }
+
+  // the host copies are released on return
+  CL_CALL(clFinish(sim_context.queue));
+}
+
 void DeviceGrid::print_cl_debug_info() const noexcept {
   cl_uint max_compute_units;
   cl_ulong max_mem_alloc_size;
@@ -313,6 +754,29 @@ void DeviceGrid::print_cl_debug_info() const noexcept {
   delete[] extensions;
 }
 
+bool DeviceGrid::has_extension(const std::string_view name) const noexcept {
+  size_t size = 0;
+  CL_CALL(clGetDeviceInfo(sim_context.device, CL_DEVICE_EXTENSIONS, 0, nullptr,
+                          &size));
+
+  std::string extensions(size, '\0');
+  CL_CALL(clGetDeviceInfo(sim_context.device, CL_DEVICE_EXTENSIONS, size,
+                          extensions.data(), nullptr));
+
+  // space separated list, match whole names only
+  std::size_t begin = 0;
+  while ((begin = extensions.find(name, begin)) != std::string::npos) {
+    const std::size_t end = begin + name.size();
+    if ((begin == 0 or extensions[begin - 1] == ' ') and
+        (end == extensions.size() or extensions[end] == ' ' or
+         extensions[end] == '\0'))
+      return true;
+    begin = end;
+  }
+
+  return false;
+}
+
 void DeviceGrid::print_cl_image_debug_info(
     const cl_image image) const noexcept {
   cl_int error = CL_SUCCESS;
@@ -360,13 +824,12 @@ DeviceGrid::read_program_source(const std::string_view path) noexcept {
   return stream.str();
 }
 
-void DeviceGrid::initialize_device() noexcept {
+void DeviceGrid::initialize_device(const device_info_t &device) noexcept {
   cl_int error = CL_SUCCESS;
 
-  // create platform and logical device
-  CL_CALL(clGetPlatformIDs(1, &sim_context.platform, nullptr));
-  CL_CALL(clGetDeviceIDs(sim_context.platform, CL_DEVICE_TYPE_GPU, 1,
-                         &sim_context.device, nullptr));
+  // platform and device picked by select_device
+  sim_context.platform = device.platform;
+  sim_context.device = device.device;
 
 #if DEBUG
   print_cl_debug_info();
@@ -386,14 +849,28 @@ void DeviceGrid::initialize_device() noexcept {
     sim_context.context = clCreateContext(properties, 1, &sim_context.device,
                                           nullptr, nullptr, &error);
     CL_CALL(error);
+  }
+#else
+  // NOTE(vir): opengl opencl interop through cl_khr_gl_sharing. fails if the
+  // gl context lives on another device (or driver), then read back instead
+  if (has_extension("cl_khr_gl_sharing")) {
+    const auto properties = gl_share_properties(sim_context.platform);
+    if (!properties.empty()) {
+      sim_context.context =
+          clCreateContext(properties.data(), 1, &sim_context.device, nullptr,
+                          nullptr, &error);
+      if (error != CL_SUCCESS)
+        sim_context.context = nullptr;
+    }
+  }
+#endif
 
+  gl_sharing = sim_context.context != nullptr;
+  if (gl_sharing) {
     std::cout << "---------------------------------------------" << std::endl;
     std::cout << "OPENGL-OPENCL sharegroup SUCCESSFULLY created" << std::endl;
     std::cout << "---------------------------------------------" << std::endl;
   } else {
-
-#endif
-
     // create context
     sim_context.context =
         clCreateContext(0, 1, &sim_context.device, nullptr, nullptr, &error);
@@ -401,11 +878,17 @@ void DeviceGrid::initialize_device() noexcept {
 
     std::cout << "------------------------------------" << std::endl;
     std::cout << "OPENGL-OPENCL sharegroup NOT created" << std::endl;
+    std::cout << "rendering through host readback     " << std::endl;
     std::cout << "------------------------------------" << std::endl;
+  }
 
-#ifdef __APPLE__
+  // NOTE(vir): with cl_khr_gl_event cl can wait for gl on the device, see
+  // render_texture
+  if (gl_sharing and has_extension("cl_khr_gl_event")) {
+    sim_context.create_gl_sync_event = reinterpret_cast<gl_sync_event_fn>(
+        clGetExtensionFunctionAddressForPlatform(sim_context.platform,
+                                                 "clCreateEventFromGLsyncKHR"));
   }
-#endif
 
   // create command queue
   sim_context.queue =
@@ -413,6 +896,59 @@ void DeviceGrid::initialize_device() noexcept {
   CL_CALL(error);
 }
 
+#ifndef __APPLE__
+std::vector<cl_context_properties>
+DeviceGrid::gl_share_properties(const cl_platform_id platform) noexcept {
+  // NOTE(vir): glfw loads glx or egl at runtime, depending on the window
+  // system. look the current context up in whichever is loaded, so neither
+  // has to be linked
+  using current_fn = void *(*)();
+  const auto lookup = [](std::initializer_list<const char *> libraries,
+                         const char *symbol) -> current_fn {
+    for (const auto library : libraries) {
+      void *handle = dlopen(library, RTLD_LAZY | RTLD_NOLOAD);
+      if (handle == nullptr)
+        continue;
+
+      const auto function = reinterpret_cast<current_fn>(dlsym(handle, symbol));
+      dlclose(handle);
+      if (function != nullptr)
+        return function;
+    }
+    return nullptr;
+  };
+
+  const auto properties = [platform](cl_context_properties display_key,
+                                     void *context, void *display) {
+    return std::vector<cl_context_properties>{
+        CL_GL_CONTEXT_KHR,   reinterpret_cast<cl_context_properties>(context),
+        display_key,         reinterpret_cast<cl_context_properties>(display),
+        CL_CONTEXT_PLATFORM, reinterpret_cast<cl_context_properties>(platform),
+        0};
+  };
+
+  const auto egl_context =
+      lookup({"libEGL.so.1", "libEGL.so"}, "eglGetCurrentContext");
+  const auto egl_display =
+      lookup({"libEGL.so.1", "libEGL.so"}, "eglGetCurrentDisplay");
+  if (egl_context != nullptr and egl_display != nullptr and
+      egl_context() != nullptr) {
+    return properties(CL_EGL_DISPLAY_KHR, egl_context(), egl_display());
+  }
+
+  const auto glx_context = lookup({"libGLX.so.0", "libGL.so.1", "libGL.so"},
+                                  "glXGetCurrentContext");
+  const auto glx_display = lookup({"libGLX.so.0", "libGL.so.1", "libGL.so"},
+                                  "glXGetCurrentDisplay");
+  if (glx_context != nullptr and glx_display != nullptr and
+      glx_context() != nullptr) {
+    return properties(CL_GLX_DISPLAY_KHR, glx_context(), glx_display());
+  }
+
+  return {};
+}
+#endif
+
 void DeviceGrid::initialize_kernels() noexcept {
   constexpr auto PROGRAM_PATH = "./shaders/compute.cl";
   constexpr auto SIM_KERNEL_NAME = "simulate";
@@ -421,6 +957,9 @@ void DeviceGrid::initialize_kernels() noexcept {
   constexpr auto RAND_KERNEL_NAME = "random_init";
   constexpr auto RENDER_KERNEL_NAME = "render_texture";
   constexpr auto SPAWN_KERNEL_NAME = "spawn_cells";
+  constexpr auto PAINT_KERNEL_NAME = "paint_cells";
+  constexpr auto CARRY_KERNEL_NAME = "carry_forward";
+  constexpr auto TEXELS_KERNEL_NAME = "render_texels";
 
   const auto kernel_source = read_program_source(PROGRAM_PATH);
   const char *kernel_source_cstr = kernel_source.c_str();
@@ -431,14 +970,21 @@ void DeviceGrid::initialize_kernels() noexcept {
 
   // allocate opencl buffers
   {
-    // double buffering, need this to be read/write for loader
+    // double buffering, either grid may be the current one so both need to
+    // be read/write for loader
     sim_context.grid = clCreateBuffer(sim_context.context, CL_MEM_READ_WRITE, memory_size, nullptr, &error);
     CL_CALL(error);
 
-    sim_context.next_grid = clCreateBuffer(sim_context.context, CL_MEM_HOST_READ_ONLY, memory_size, nullptr, &error);
+    sim_context.next_grid = clCreateBuffer(sim_context.context, CL_MEM_READ_WRITE, memory_size, nullptr, &error);
+    CL_CALL(error);
+
+    // last step that stamped each work group, step 0 is never carried forward
+    std::vector<cl_uint> tile_steps((width / LOCAL_WIDTH) * (height / LOCAL_HEIGHT), 0);
+    sim_context.tile_steps = clCreateBuffer(sim_context.context, CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS | CL_MEM_COPY_HOST_PTR, tile_steps.size() * sizeof(cl_uint), tile_steps.data(), &error);
     CL_CALL(error);
 
-    sim_context.seeds = clCreateBuffer(sim_context.context, CL_MEM_WRITE_ONLY, num_cells * sizeof(cl_long), nullptr, &error);
+    // paint batches are written by the host, read by the paint kernel
+    sim_context.paint_mask = clCreateBuffer(sim_context.context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, num_cells, nullptr, &error);
     CL_CALL(error);
   }
 
@@ -447,7 +993,9 @@ void DeviceGrid::initialize_kernels() noexcept {
   CL_CALL(error);
 
   // TODO(vir): add optimization flags
-  if (clBuildProgram(sim_context.program, 0, nullptr, "-Ishaders/" , nullptr, nullptr) != CL_SUCCESS) {
+  // NOTE(vir): the kernels are built for the grid layout, see base.cl
+  const auto build_options = layout == Layout::PLANES ? "-Ishaders/ -DUSE_PLANES=1" : "-Ishaders/";
+  if (clBuildProgram(sim_context.program, 0, nullptr, build_options, nullptr, nullptr) != CL_SUCCESS) {
     // get the build log from the device
     cl_device_id deviceId;
     size_t buildLogSize;
@@ -485,39 +1033,64 @@ void DeviceGrid::initialize_kernels() noexcept {
   sim_context.spawn_kernel = clCreateKernel(sim_context.program, SPAWN_KERNEL_NAME, &error);
   CL_CALL(error);
 
+  // brush batch kernel
+  sim_context.paint_kernel = clCreateKernel(sim_context.program, PAINT_KERNEL_NAME, &error);
+  CL_CALL(error);
+
+  // next grid catch up kernel
+  sim_context.carry_kernel = clCreateKernel(sim_context.program, CARRY_KERNEL_NAME, &error);
+  CL_CALL(error);
+
+  // texture compute kernel without gl sharing
+  sim_context.texels_kernel = clCreateKernel(sim_context.program, TEXELS_KERNEL_NAME, &error);
+  CL_CALL(error);
+
   cl_uint2 grid_dim = {width, height};
 
+  // NOTE(vir): kernel arg 0 (random key) is set per frame by set_rng_key()
+
   // set init kernel args: fixed
-  CL_CALL(clSetKernelArg(sim_context.init_kernel, 0, sizeof(cl_mem), &sim_context.seeds));
   CL_CALL(clSetKernelArg(sim_context.init_kernel, 1, sizeof(cl_mem), &sim_context.grid));
   CL_CALL(clSetKernelArg(sim_context.init_kernel, 2, sizeof(cl_mem), &sim_context.next_grid));
   CL_CALL(clSetKernelArg(sim_context.init_kernel, 3, sizeof(cl_uint2), &grid_dim));
 
   // set random init kernel args: fixed
-  CL_CALL(clSetKernelArg(sim_context.rand_kernel, 0, sizeof(cl_mem), &sim_context.seeds));
   CL_CALL(clSetKernelArg(sim_context.rand_kernel, 1, sizeof(cl_mem), &sim_context.grid));
   CL_CALL(clSetKernelArg(sim_context.rand_kernel, 2, sizeof(cl_mem), &sim_context.next_grid));
   CL_CALL(clSetKernelArg(sim_context.rand_kernel, 3, sizeof(cl_uint2), &grid_dim));
 
   // NOTE(vir): we set render kernel data args in Device::render_texture()
   // these are the fixed ones
-  CL_CALL(clSetKernelArg(sim_context.render_kernel, 0, sizeof(cl_mem), &sim_context.seeds));
-  CL_CALL(clSetKernelArg(sim_context.render_kernel, 4, sizeof(cl_uint2), &grid_dim));
-  CL_CALL(clSetKernelArg(sim_context.render_kernel, 5, sizeof(unsigned int), &cell_size));
+  set_rng_key(sim_context.render_kernel);
+  CL_CALL(clSetKernelArg(sim_context.render_kernel, 3, sizeof(cl_uint2), &grid_dim));
+  CL_CALL(clSetKernelArg(sim_context.render_kernel, 4, sizeof(unsigned int), &cell_size));
+
+  // NOTE(vir): we set texels kernel data args in DeviceGrid::set_texture_target()
+  // and DeviceGrid::render_texture(), these are the fixed ones
+  CL_CALL(clSetKernelArg(sim_context.texels_kernel, 2, sizeof(cl_uint2), &grid_dim));
 
   // NOTE(vir): we set spawn kernel data args in DeviceGrid::spawn_cells()
   // these are the fixed ones
-  CL_CALL(clSetKernelArg(sim_context.spawn_kernel, 0, sizeof(cl_mem), &sim_context.seeds));
   CL_CALL(clSetKernelArg(sim_context.spawn_kernel, 6, sizeof(cl_uint2), &grid_dim));
   CL_CALL(clSetKernelArg(sim_context.spawn_kernel, 7, sizeof(unsigned int), &cell_size));
 
+  // NOTE(vir): we set paint kernel data args in DeviceGrid::paint_cells()
+  // these are the fixed ones
+  CL_CALL(clSetKernelArg(sim_context.paint_kernel, 3, sizeof(cl_mem), &sim_context.paint_mask));
+  CL_CALL(clSetKernelArg(sim_context.paint_kernel, 6, sizeof(cl_uint2), &grid_dim));
+
   // NOTE(vir): we set sim/fluid kernel data args in DeviceGrid::simulate()
   // these are the fixed ones
-  CL_CALL(clSetKernelArg(sim_context.sim_kernel, 0, sizeof(cl_mem), &sim_context.seeds));
   CL_CALL(clSetKernelArg(sim_context.sim_kernel, 3, sizeof(cl_uint2), &grid_dim));
+  CL_CALL(clSetKernelArg(sim_context.sim_kernel, 4, sizeof(cl_mem), &sim_context.tile_steps));
 
-  CL_CALL(clSetKernelArg(sim_context.fluid_kernel, 0, sizeof(cl_mem), &sim_context.seeds));
   CL_CALL(clSetKernelArg(sim_context.fluid_kernel, 3, sizeof(cl_uint2), &grid_dim));
+  CL_CALL(clSetKernelArg(sim_context.fluid_kernel, 4, sizeof(cl_mem), &sim_context.tile_steps));
+
+  // NOTE(vir): we set carry kernel grid args in DeviceGrid::simulate()
+  // these are the fixed ones
+  CL_CALL(clSetKernelArg(sim_context.carry_kernel, 2, sizeof(cl_uint2), &grid_dim));
+  CL_CALL(clSetKernelArg(sim_context.carry_kernel, 3, sizeof(cl_mem), &sim_context.tile_steps));
   // clang-format on
 }
 
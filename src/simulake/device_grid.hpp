@@ -1,13 +1,17 @@
 #ifndef SIMULAKE_DEVICE_GRID_HPP
 #define SIMULAKE_DEVICE_GRID_HPP
 
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include "simulake.hpp"
 
 #include "cell.hpp"
 #include "grid_base.hpp"
+#include "random.hpp"
 
 namespace simulake {
 
@@ -34,9 +38,51 @@ public:
     bool updated = false;
   };
 
-  /* initialize device grid with empty (AIR) cells */
+  /* how cells are laid out in device memory, rows of cells are contiguous
+   * in both so neighbouring work items read neighbouring cells */
+  enum class Layout : std::uint8_t {
+    CELLS,  /* one device_cell_t per cell */
+    PLANES, /* one array per attribute, see shaders/layout.cl */
+  };
+
+  /* an opencl device and the platform providing it */
+  struct device_info_t {
+    cl_platform_id platform = nullptr;
+    cl_device_id device = nullptr;
+    cl_device_type type = CL_DEVICE_TYPE_DEFAULT;
+    std::string platform_name;
+    std::string device_name;
+  };
+
+  /* device selection, default fields match any device. among matches gpus
+   * are preferred, then cpus (e.g. pocl), then anything else */
+  struct device_options_t {
+    cl_device_type type = CL_DEVICE_TYPE_ALL; /* any of these types */
+    std::string name; /* substring of device or platform name, any case */
+    std::optional<std::uint32_t> index; /* position in list_devices() */
+  };
+
+  /* all devices of all platforms, in platform order */
+  static std::vector<device_info_t> list_devices() noexcept;
+
+  /* preferred device matching options, none if no device does */
+  static std::optional<device_info_t>
+  select_device(const device_options_t &) noexcept;
+
+  /* options from a device spec: "gpu", "cpu", "accelerator" or "any", a
+   * list_devices() index, or else a name */
+  static device_options_t parse_device_spec(const std::string_view) noexcept;
+
+  /* device grid on the preferred device matching options, nullptr (and an
+   * error printed) if no device does */
+  static std::unique_ptr<DeviceGrid>
+  create(const std::uint32_t, const std::uint32_t, const std::uint32_t,
+         const device_options_t &, const Layout);
+
+  /* initialize device grid with empty (AIR) cells on given device */
   explicit DeviceGrid(const std::uint32_t, const std::uint32_t,
-                      const std::uint32_t);
+                      const std::uint32_t, const device_info_t &,
+                      const Layout);
 
   /* enable moves */
   explicit DeviceGrid(DeviceGrid &&) = default;
@@ -58,6 +104,7 @@ public:
   /* mouse input api */
   void spawn_cells(const std::tuple<std::uint32_t, std::uint32_t> &,
                    const std::uint32_t, const CellType) noexcept override;
+  void paint_cells(const paint_mask_t &) noexcept override;
 
   inline std::uint32_t get_width() const noexcept override { return width; }
   inline std::uint32_t get_height() const noexcept override { return height; }
@@ -65,7 +112,7 @@ public:
     return sizeof(device_cell_t);
   }
 
-  serialized_grid_t serialize() const noexcept override;
+  void serialize_into(serialized_grid_t &) const noexcept override;
   void deserialize(const serialized_grid_t &) noexcept override;
 
   constexpr bool is_device_grid() const noexcept override { return true; }
@@ -82,6 +129,26 @@ private:
   constexpr inline static size_t LOCAL_WIDTH = 10;
   constexpr inline static size_t LOCAL_HEIGHT = 10;
 
+  /* offsets of the rng key per pass of a frame, so passes draw from their
+   * own streams. even, the squares key must stay odd */
+  constexpr inline static cl_ulong RNG_STEP_STREAM = 0;
+  constexpr inline static cl_ulong RNG_FLUID_STREAM = 2;
+  constexpr inline static cl_ulong RNG_SPAWN_STREAM = 4;
+
+  /* texels read back without gl sharing, one slot is read into while the
+   * other one is uploaded */
+  constexpr inline static size_t TEXELS_SLOTS = 2;
+  struct texels_slot_t {
+    GLuint pbo = 0;          /* unpack buffer into the texture */
+    void *pixels = nullptr;  /* pbo mapped as the read target, if it mapped */
+    std::vector<cl_float2> fallback; /* read target if the pbo did not map */
+    cl_event read = nullptr; /* read in flight, null once uploaded */
+  };
+
+  /* clCreateEventFromGLsyncKHR of cl_khr_gl_event */
+  using gl_sync_event_fn = cl_event(CL_API_CALL *)(cl_context, cl_GLsync,
+                                                   cl_int *);
+
   /* opencl structures */
   struct sim_context_t {
     cl_platform_id platform = nullptr;
@@ -97,30 +164,88 @@ private:
     cl_kernel rand_kernel = nullptr;
     cl_kernel render_kernel = nullptr;
     cl_kernel spawn_kernel = nullptr;
+    cl_kernel paint_kernel = nullptr;
+    cl_kernel carry_kernel = nullptr;
+    cl_kernel texels_kernel = nullptr;
 
-    /* buffers */
+    /* buffers, the current grid is grid if flip_flag else next_grid */
     cl_mem grid = nullptr;
     cl_mem next_grid = nullptr;
-    cl_mem seeds = nullptr;
+    cl_mem tile_steps = nullptr; /* last step that stamped each work group */
+    cl_mem paint_mask = nullptr; /* coverage of a paint batch, up to grid size */
+
+    /* render target, shares the texture set by set_texture_target */
+    cl_mem texture_image = nullptr;
+
+    /* render target without gl sharing, see upload_texture */
+    cl_mem texels = nullptr; /* texture contents, on the device */
+    texels_slot_t texels_slots[TEXELS_SLOTS];
+    std::uint32_t texels_slot = 0; /* slot the next read goes into */
+
+    /* gl to cl sync, create_gl_sync_event is null without cl_khr_gl_event */
+    gl_sync_event_fn create_gl_sync_event = nullptr;
+    GLsync gl_fence = nullptr; /* waited on by the last render_texture */
   };
 
   /* initialize logical device and compute structures */
-  void initialize_device() noexcept;
+  void initialize_device(const device_info_t &) noexcept;
   void initialize_kernels() noexcept;
 
+  /* grid holding the current state, and the other one */
+  inline const cl_mem &current_grid() const noexcept {
+    return flip_flag ? sim_context.grid : sim_context.next_grid;
+  }
+  inline const cl_mem &other_grid() const noexcept {
+    return flip_flag ? sim_context.next_grid : sim_context.grid;
+  }
+
   /* render into gl texture */
-  void render_texture() const noexcept;
+  void render_texture() noexcept;
+
+  /* wait for the texels read back by the previous render_texture and copy
+   * them into the texture, when gl sharing is not available */
+  void upload_texture() noexcept;
+
+  /* release what set_texture_target created */
+  void release_texture_target() noexcept;
+
+  /* set random key (kernel arg 0) of given kernel for the current frame,
+   * offset by given stream */
+  void set_rng_key(cl_kernel, cl_ulong = RNG_STEP_STREAM) const noexcept;
 
   /* helpers */
   static std::string read_program_source(const std::string_view) noexcept;
   void print_cl_debug_info() const noexcept;
   void print_cl_image_debug_info(const cl_image) const noexcept;
+  bool has_extension(const std::string_view) const noexcept;
+
+  /* cells of given grid buffer, in row major order whatever the layout */
+  std::vector<device_cell_t> read_cells(const cl_mem) const noexcept;
 
-  GLuint texture_target;
+  /* write cells in row major order into both grid buffers */
+  void write_cells(const std::vector<device_cell_t> &) noexcept;
+
+#ifndef __APPLE__
+  /* context properties sharing the current glx or egl context with cl, empty
+   * if there is none */
+  static std::vector<cl_context_properties>
+  gl_share_properties(const cl_platform_id) noexcept;
+#endif
+
+  GLuint texture_target = 0;
+  bool gl_sharing = false; /* context shares gl objects, else read back */
+  Layout layout;
   std::uint32_t num_cells;
   std::uint32_t memory_size;
   sim_context_t sim_context;
 
+  /* host side coverage of the last paint batch, see paint_cells */
+  std::vector<std::uint8_t> paint_coverage;
+
+  /* random number generator state, see random.hpp */
+  std::uint64_t seed = 0;
+  std::uint32_t frame = 0;
+
   bool flip_flag;
   std::uint32_t width;
   std::uint32_t height;
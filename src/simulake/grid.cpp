@@ -1,11 +1,10 @@
+#include <bit>
 #include <cassert>
 #include <iostream>
 #include <optional>
 #include <random>
 #include <thread>
 
-#include <omp.h>
-
 #include "grid.hpp"
 #include "simulake/cell.hpp"
 #include "utils.hpp"
@@ -13,170 +12,489 @@
 namespace simulake {
 
 Grid::Grid(const std::uint32_t _width, const std::uint32_t _height)
-    : width(_width), height(_height) {
+    : _raster(_width, _height),
+      chunks_x((_width + CHUNK_SIZE - 1) / CHUNK_SIZE),
+      chunks_y((_height + CHUNK_SIZE - 1) / CHUNK_SIZE), width(_width),
+      height(_height) {
+
+  std::random_device rd;
+  seed = (static_cast<std::uint64_t>(rd()) << 32) | rd();
+  frame_key = rng_frame_key(seed, frame);
+
+  /* ghost border pads the grid by one cell on every side, morton layout
+   * further pads it to whole blocks */
+  if constexpr (MORTON_LAYOUT) {
+    row_stride = (width + 2 + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    num_cells = static_cast<std::size_t>(row_stride) *
+                ((height + 2 + CHUNK_SIZE - 1) / CHUNK_SIZE) * CHUNK_SIZE *
+                CHUNK_SIZE;
+  } else {
+    row_stride = width + 2;
+    num_cells = static_cast<std::size_t>(row_stride) * (height + 2);
+  }
+
+  /* one word per chunk column, plus a ghost word on either side */
+  material_stride = chunks_x + 2;
+  eject_stride = (width + EJECT_SPAN - 1) / EJECT_SPAN;
 
   stride = 2; // (type, mass)
   reset();
 
   const auto NUM_THREADS = std::thread::hardware_concurrency();
-  omp_set_num_threads(std::max(1, static_cast<int>(NUM_THREADS - 2)));
+  scheduler = std::make_unique<Scheduler>(
+      std::max(1, static_cast<int>(NUM_THREADS - 2)));
+}
+
+void Grid::grid_data_t::assign(const std::size_t size,
+                               const cell_data_t &cell) noexcept {
+  type.assign(size, cell.type);
+  mass.assign(size, cell.mass);
+  velocity.assign(size, cell.velocity);
+  stamp.assign(size, 0);
 }
 
 void Grid::reset() noexcept {
   /* construct in place */
-  _grid.resize(height, {width, cell_data_t{.type = CellType::AIR}});
+  _grid.assign(num_cells, cell_data_t{.type = CellType::AIR});
+
+  /* ghost border, reads as out of bounds */
+  const int w = static_cast<int>(width), h = static_cast<int>(height);
+  for (int x = -1; x <= w; x += 1) {
+    _grid.type[index(x, -1)] = CellType::NONE;
+    _grid.type[index(x, h)] = CellType::NONE;
+  }
+
+  for (int y = 0; y < h; y += 1) {
+    _grid.type[index(-1, y)] = CellType::NONE;
+    _grid.type[index(w, y)] = CellType::NONE;
+  }
 
   /* deep copy construct (same dimensions and contents) */
   _next_grid = _grid;
+  _rest.assign(num_cells, 0);
+
+  const std::size_t words =
+      static_cast<std::size_t>(material_stride) * (height + 2);
+  for (auto &plane : _materials)
+    plane.assign(words, 0);
+
+  for (std::size_t t = 0; t < NUM_TYPES; t += 1) {
+    if (cpu_dispatch_t::stepping_of(static_cast<CellType>(t)) != Stepping::NONE)
+      _types[t].assign(words, 0);
+    else
+      _types[t].clear();
+  }
+  _cell_plane.assign(words, 0);
+
+  for (std::uint32_t cx = 0; cx < chunks_x; cx += 1)
+    update_planes(cx, 0, static_cast<int>(height));
+
+  _particles.clear();
+  _ejected.assign(static_cast<std::size_t>(eject_stride) *
+                      ((height + EJECT_SPAN - 1) / EJECT_SPAN),
+                  {});
+
+  /* empty grid has nothing to step, all chunks asleep */
+  _chunks = std::vector<chunk_t>(static_cast<std::size_t>(chunks_x) * chunks_y);
 }
 
 void Grid::spawn_cells(const std::tuple<std::uint32_t, std::uint32_t> &center,
                        const std::uint32_t paint_radius,
                        const CellType paint_target) noexcept {
+  paint_mask_t mask;
+  mask.target = paint_target;
 
-  float cx = std::get<0>(center);
-  float cy = std::get<1>(center);
+  _raster.disc(std::get<0>(center), std::get<1>(center), paint_radius);
+  _raster.take(mask);
+  paint_cells(mask);
+}
 
-  const int y_start = std::max(static_cast<int>(cy - paint_radius), 0);
-  const int y_end =
-      std::min(static_cast<int>(cy + paint_radius), static_cast<int>(height));
+void Grid::paint_cells(const paint_mask_t &mask) noexcept {
+  /* NOTE(vir): one dispatch per batch, the span loops call the rule's spawn
+   * directly */
+  cpu_dispatch_t::visit(mask.target, [&]<typename Cell>() {
+    for (const auto &span : mask.spans) {
+      if (span.y >= height or span.x_end > width) [[unlikely]] {
+        std::cerr << "ERROR::GRID: out of bound: " << span.x_end << ' '
+                  << span.y << std::endl;
+        continue;
+      }
 
-  const int x_start = std::max(static_cast<int>(cx - paint_radius), 0);
-  const int x_end =
-      std::min(static_cast<int>(cx + paint_radius), static_cast<int>(width));
+      fill_span<Cell>(span.x_begin, span.x_end, span.y);
+      touch_span(span.x_begin, span.x_end, span.y);
+    }
+  });
+}
 
-  for (int y = y_start; y < y_end; ++y) {
-    for (int x = x_start; x < x_end; ++x) {
-      int dist = static_cast<int>(sqrt(pow(static_cast<int>(cx) - x, 2) +
-                                       pow(static_cast<int>(cy) - y, 2)));
+template <typename Cell>
+void Grid::fill_span(int x_start, int x_end, int y) noexcept {
+  constexpr bool overwrite = Cell::type == CellType::AIR;
 
-      bool should_paint =
-          dist <= paint_radius and (paint_target == CellType::AIR or
-                                    cell_at(x, y).type == CellType::AIR);
+  /* NOTE(vir): row major rows are contiguous, an erase is a fill per plane */
+  if constexpr (overwrite and !MORTON_LAYOUT) {
+    const cell_data_t cell = Cell::spawn({x_start, y}, *this);
+    const std::size_t idx = index(x_start, y);
+    const std::size_t count = x_end - x_start;
 
-      /* skip if should_paint is false */
-      if (!should_paint)
-        continue;
+    std::fill_n(&_grid.type[idx], count, cell.type);
+    std::fill_n(&_grid.mass[idx], count, cell.mass);
+    std::fill_n(&_grid.velocity[idx], count, cell.velocity);
+    std::fill_n(&_grid.stamp[idx], count, cell.updated ? generation : 0);
+    return;
+  }
 
-      cell_data_t spawn_cell;
+  for (int x = x_start; x < x_end; x += 1) {
+    const std::size_t idx = index(x, y);
+    if (overwrite or _grid.type[idx] == CellType::AIR)
+      store(_grid, idx, Cell::spawn({x, y}, *this));
+  }
+}
 
-      switch (paint_target) {
-      case CellType::AIR:
-        spawn_cell = AirCell::spawn({x, y}, *this);
-        break;
+void Grid::simulate(float delta_time) noexcept {
+  this->delta_time = delta_time;
+  frame_key = rng_frame_key(seed, ++frame);
 
-      case CellType::SMOKE:
-        spawn_cell = SmokeCell::spawn({x, y}, *this);
-        break;
+  /* bucket awake chunks by checkerboard phase */
+  for (auto &chunks : _phase_chunks)
+    chunks.clear();
 
-      case CellType::FIRE:
-        spawn_cell = FireCell::spawn({x, y}, *this);
-        break;
+  for (std::uint32_t cy = 0; cy < chunks_y; cy += 1) {
+    for (std::uint32_t cx = 0; cx < chunks_x; cx += 1) {
+      if (!_chunks[cy * chunks_x + cx].curr.empty())
+        _phase_chunks[(cy & 1) * 2 + (cx & 1)].push_back(cy * chunks_x + cx);
+    }
+  }
 
-      case CellType::WATER:
-        spawn_cell = WaterCell::spawn({x, y}, *this);
-        break;
+  /* NOTE(vir): buffers only differ where cells changed last frame or were
+   * spawned since, and those cells are inside the current rects. syncing
+   * just the rects makes _next_grid a full copy of _grid. must finish
+   * before stepping, rules write into neighboring chunks */
+  for (const auto &chunks : _phase_chunks) {
+    scheduler->run(chunks.size(), [this, &chunks](std::uint32_t i) {
+      sync_chunk(chunks[i] % chunks_x, chunks[i] / chunks_x);
+    });
+  }
 
-      case CellType::OIL:
-        // spawn_cell = OilCell::spawn({x, y}, *this);
-        break;
+  /* chunks in the same phase are never neighbors, step them in parallel.
+   * their cost varies wildly (asleep rows, fire fronts), the scheduler
+   * balances it by stealing */
+  for (const auto &chunks : _phase_chunks) {
+    scheduler->run(chunks.size(), [this, &chunks](std::uint32_t i) {
+      step_chunk(chunks[i] % chunks_x, chunks[i] / chunks_x);
+    });
+  }
 
-      case CellType::SAND:
-        spawn_cell = SandCell::spawn({x, y}, *this);
-        break;
+  step_particles();
+  std::swap(_grid, _next_grid);
 
-      case CellType::JET_FUEL:
-        spawn_cell = JetFuelCell::spawn({x, y}, *this);
-        break;
+  /* cells changed this frame are stepped next frame */
+  for (auto &chunk : _chunks)
+    chunk.curr.take(chunk.next);
 
-      case CellType::STONE:
-        spawn_cell = StoneCell::spawn({x, y}, *this);
-        break;
+  /* stamps of this frame are stale from now on, skip the reserved 0 */
+  generation = generation == MAX_GENERATION ? 1 : generation + 1;
+  expire_stamps();
+}
+
+void Grid::expire_stamps() noexcept {
+  /* every cell is zeroed once per STAMP_STRIPES frames, before generation
+   * wraps around. stale stamps carry no information, clearing is safe */
+  const std::size_t cells = (num_cells + STAMP_STRIPES - 1) / STAMP_STRIPES;
+  const std::size_t start = (frame % STAMP_STRIPES) * cells;
+  const std::size_t end = std::min(start + cells, num_cells);
+
+  if (start >= end)
+    return;
+
+  for (auto *planes : {&_grid, &_next_grid})
+    std::fill(planes->stamp.begin() + start, planes->stamp.begin() + end, 0);
+}
+
+std::tuple<int, int, int, int>
+Grid::clamped_rect(std::uint32_t cx, std::uint32_t cy) const noexcept {
+  const rect_t &rect = _chunks[cy * chunks_x + cx].curr;
+  const int chunk_x = static_cast<int>(cx * CHUNK_SIZE);
+  const int chunk_y = static_cast<int>(cy * CHUNK_SIZE);
+  const int chunk_size = static_cast<int>(CHUNK_SIZE);
+
+  return {std::max(rect.min_x.load(), chunk_x),
+          std::max(rect.min_y.load(), chunk_y),
+          std::min({rect.max_x.load() + 1, chunk_x + chunk_size,
+                    static_cast<int>(width)}),
+          std::min({rect.max_y.load() + 1, chunk_y + chunk_size,
+                    static_cast<int>(height)})};
+}
+
+void Grid::sync_chunk(std::uint32_t cx, std::uint32_t cy) noexcept {
+  const auto copy = [this](const std::size_t begin, const std::size_t count) {
+    std::copy_n(&_grid.type[begin], count, &_next_grid.type[begin]);
+    std::copy_n(&_grid.mass[begin], count, &_next_grid.mass[begin]);
+    std::copy_n(&_grid.velocity[begin], count, &_next_grid.velocity[begin]);
+    std::copy_n(&_grid.stamp[begin], count, &_next_grid.stamp[begin]);
+  };
+
+  const auto [x_start, y_start, x_end, y_end] = clamped_rect(cx, cy);
+
+  if constexpr (MORTON_LAYOUT) {
+    /* rect is scattered in Z-order (and blocks are offset by the ghost
+     * border, so they straddle chunks), copy cell by cell */
+    for (int y = y_start; y < y_end; y += 1)
+      for (int x = x_start; x < x_end; x += 1)
+        copy(index(x, y), 1);
+  } else {
+    for (int y = y_start; y < y_end; y += 1)
+      copy(index(x_start, y), x_end - x_start);
+  }
+
+  update_planes(cx, y_start, y_end);
+}
+
+void Grid::update_planes(std::uint32_t cx, int y_start, int y_end) noexcept {
+  constexpr std::size_t COUNT = static_cast<std::size_t>(Material::COUNT);
+  const int x_start = static_cast<int>(cx * CHUNK_SIZE);
+  const int x_end = std::min(x_start + static_cast<int>(CHUNK_SIZE),
+                             static_cast<int>(width));
+
+  for (int y = y_start; y < y_end; y += 1) {
+    std::uint64_t words[COUNT] = {};
+    std::uint64_t types[NUM_TYPES] = {};
+
+    for (int x = x_start; x < x_end; x += 1) {
+      const std::size_t idx = index(x, y);
+      const CellType type = _grid.type[idx];
+      const std::uint64_t bits = BaseCell::materials(type);
+
+      for (std::size_t m = 0; m < COUNT; m += 1)
+        words[m] |= ((bits >> m) & 1) << (x - x_start);
+
+      /* age the cell, sleeping cells stay out of the type planes */
+      _rest[idx] += _rest[idx] != UINT8_MAX;
+      const bool awake = _rest[idx] <= cpu_dispatch_t::sleep_after_of(type);
+
+      /* NOTE(vir): deserialized grids may hold unknown types, those step as
+       * static cells */
+      if (static_cast<std::size_t>(type) < NUM_TYPES) [[likely]]
+        types[static_cast<std::size_t>(type)] |=
+            static_cast<std::uint64_t>(awake) << (x - x_start);
+    }
+
+    const std::size_t word = material_index(x_start, y);
+    for (std::size_t m = 0; m < COUNT; m += 1)
+      _materials[m][word] = words[m];
 
-      default:
-        break; // CellType::NONE
-      };
+    std::uint64_t cells = 0;
+    for (std::size_t t = 0; t < NUM_TYPES; t += 1) {
+      const Stepping stepping =
+          cpu_dispatch_t::stepping_of(static_cast<CellType>(t));
 
-      /* check if cell type is valid */
-      if (spawn_cell.type != CellType::NONE)
-        set_curr(x, y, spawn_cell);
+      if (stepping != Stepping::NONE)
+        _types[t][word] = types[t];
+      if (stepping == Stepping::CELL)
+        cells |= types[t];
     }
+    _cell_plane[word] = cells;
   }
 }
 
-void Grid::simulate(float delta_time) noexcept {
-  this->delta_time = delta_time;
-  _next_grid = _grid;
+void Grid::step_chunk(std::uint32_t cx, std::uint32_t cy) noexcept {
+  const auto [x_start, y_start, x_end, y_end] = clamped_rect(cx, cy);
 
-  for (int x = 0; x < width; x += 1) {
-    for (int y = 0; y < height; y += 1) {
-      switch (_grid[y][x].type) {
-      case CellType::AIR:
-        AirCell::step({x, y}, *this);
-        break;
+  if (x_start >= x_end or y_start >= y_end)
+    return;
 
-      case CellType::WATER:
-        WaterCell::step({x, y}, *this);
-        break;
+  switch (traversal) {
+  case Traversal::COLUMNS: {
+    /* the rect is inside one chunk column, so each row is one plane word */
+    const int x0 = x_start & ~63;
+    std::uint64_t columns = 0;
 
-      case CellType::OIL:
-        // OilCell::step({x, y}, *this);
-        break;
+    for (int y = y_start; y < y_end; y += 1)
+      columns |= _cell_plane[material_index(x_start, y)];
 
-      case CellType::SAND:
-        SandCell::step({x, y}, *this);
-        break;
+    for (columns &= span_mask(x_start, x_end); columns != 0;
+         columns &= columns - 1) {
+      const int i = std::countr_zero(columns);
 
-      case CellType::FIRE:
-        FireCell::step({x, y}, *this);
-        break;
+      for (int y = y_start; y < y_end; y += 1) {
+        if ((_cell_plane[material_index(x_start, y)] >> i) & 1)
+          step_cell(x0 + i, y);
+      }
+    }
+    break;
+  }
 
-      case CellType::GREEK_FIRE:
-        // FireCell::step({x, y}, *this);
-        break;
+  case Traversal::ROWS:
+    for (int y = y_end - 1; y >= y_start; y -= 1)
+      step_row(y, x_start, x_end, (y + frame) & 1);
+    break;
+
+  case Traversal::TILES: {
+    /* tiles are aligned to the grid (and so to the morton blocks) */
+    const int tile = static_cast<int>(TILE_SIZE);
+
+    for (int ty = (y_end - 1) / tile * tile; ty >= y_start - y_start % tile;
+         ty -= tile) {
+      for (int tx = x_start / tile * tile; tx < x_end; tx += tile) {
+        const int x0 = std::max(tx, x_start);
+        const int x1 = std::min(tx + tile, x_end);
+
+        for (int y = std::min(ty + tile, y_end) - 1; y >= std::max(ty, y_start);
+             y -= 1)
+          step_row(y, x0, x1, (y + frame) & 1);
+      }
+    }
+    break;
+  }
+  };
 
-      case CellType::JET_FUEL:
-        JetFuelCell::step({x, y}, *this);
-        break;
+  /* row-wise types (sand, smoke) are stepped a row word at a time, after
+   * the other cells of the chunk, so their swaps see the final next state of
+   * the targets */
+  for (int y = y_end - 1; y >= y_start; y -= 1)
+    cpu_dispatch_t::step_row(x_start, x_end, y, *this);
+}
 
-      case CellType::SMOKE:
-        SmokeCell::step({x, y}, *this);
-        break;
+void Grid::step_row(int y, int x_start, int x_end, bool reverse) noexcept {
+  /* same order as a scan of every cell, minus the ones with no rule */
+  const int x0 = x_start & ~63;
+  std::uint64_t bits =
+      _cell_plane[material_index(x_start, y)] & span_mask(x_start, x_end);
+
+  if (reverse) {
+    while (bits != 0) {
+      const int i = 63 - std::countl_zero(bits);
+      bits ^= std::uint64_t{1} << i;
+      step_cell(x0 + i, y);
+    }
+  } else {
+    for (; bits != 0; bits &= bits - 1)
+      step_cell(x0 + std::countr_zero(bits), y);
+  }
+}
 
-      case CellType::STONE:
-        // StoneCell::step({x, y}, *this);
-        break;
+void Grid::step_cell(int x, int y) noexcept {
+  cpu_dispatch_t::step(_grid.type[index(x, y)], {x, y}, *this);
+}
+
+void Grid::step_particles() noexcept {
+  for (auto &bucket : _ejected) {
+    _particles.insert(_particles.end(), bucket.begin(), bucket.end());
+    bucket.clear();
+  }
+
+  if (_particles.empty())
+    return;
 
-      default: // CellType::NONE
+  /* gravity is effectively 50, as for sand */
+  const float gravity = BaseCell::gravity * 5.0f * delta_time;
+  const float w = static_cast<float>(width);
+  const int h = static_cast<int>(height);
+  std::size_t kept = 0;
+
+  for (particle_t particle : _particles) {
+    particle.velocity.y += gravity;
+    particle.velocity = glm::clamp(particle.velocity, -MAX_PARTICLE_SPEED,
+                                   MAX_PARTICLE_SPEED);
+
+    /* sweep the path a cell at a time, from the particle's own cell. walls
+     * stop horizontal motion, above the grid there is nothing to hit */
+    const int steps = static_cast<int>(std::ceil(std::max(
+        std::abs(particle.velocity.x), std::abs(particle.velocity.y))));
+    glm::vec2 step = particle.velocity / static_cast<float>(std::max(steps, 1));
+    std::optional<glm::ivec2> landing; /* last air cell on the path */
+    bool reached_air = false, hit = false;
+
+    for (int i = 0; i <= steps and !hit; i += 1) {
+      glm::vec2 position = particle.position + (i > 0 ? step : glm::vec2{0.0f});
+
+      if (position.x < 0.0f or position.x >= w) {
+        position.x = std::clamp(position.x, 0.0f, std::nextafter(w, 0.0f));
+        step.x = particle.velocity.x = 0.0f;
+      }
+
+      const int x = static_cast<int>(position.x);
+      const int y = static_cast<int>(std::floor(position.y));
+      const bool air =
+          y < 0 or (y < h and _next_grid.type[index(x, y)] == CellType::AIR);
+
+      /* until it reaches air, the particle is leaving the cell it was
+       * ejected from (now taken by whatever displaced it) */
+      hit = !air and (reached_air or y >= h);
+      if (hit)
         break;
-      };
+
+      particle.position = position;
+      reached_air = reached_air or air;
+      landing = air and y >= 0 ? std::optional{glm::ivec2{x, y}} : std::nullopt;
     }
-  }
 
-  /* reset updated */
-  for (int x = 0; x < width; x += 1) {
-    for (int y = 0; y < height; y += 1) {
-      _next_grid[y][x].updated = false;
+    if (hit and landing) {
+      set_next(landing->x, landing->y,
+               {.type = particle.type, .mass = particle.mass, .updated = true});
+      continue;
     }
+
+    /* NOTE(vir): a full column has no room to land, wait above the grid.
+     * a particle buried without reaching air (cells moved into its way, or
+     * the floor under the cell it left) climbs a cell and falls again from
+     * there */
+    if (hit or !reached_air) {
+      particle.position.y -= reached_air ? 0.0f : 1.0f;
+      particle.velocity = glm::vec2{0.0f};
+    }
+
+    _particles[kept++] = particle;
   }
 
-  std::swap(_grid, _next_grid);
+  _particles.resize(kept);
 }
 
-GridBase::serialized_grid_t Grid::serialize() const noexcept {
-  std::vector<float> buf(width * height * stride);
+std::uint64_t Grid::updated_bits(int x0, int y) const noexcept {
+  const int x_start = std::max(x0, 0);
+  const int x_end = std::min(x0 + 64, static_cast<int>(width));
+  std::uint64_t bits = 0;
+
+  if (y < 0 or y >= static_cast<int>(height))
+    return 0;
+
+  for (int x = x_start; x < x_end; x += 1)
+    bits |= static_cast<std::uint64_t>(_grid.stamp[index(x, y)] == generation)
+            << (x - x0);
+
+  return bits;
+}
+
+void Grid::serialize_into(GridBase::serialized_grid_t &data) const noexcept {
+  /* NOTE(vir): assign keeps the capacity, a reused buffer is not reallocated */
+  auto &buf = data.buffer;
+  buf.assign(width * height * stride, 0.0f);
 
   for (std::uint32_t y = 0; y < height; y += 1) {
     for (std::uint32_t x = 0; x < width; x += 1) {
       const std::uint64_t base_index = (y * width + x) * stride;
-      const cell_data_t cell = cell_at(x, height - y - 1);
+      const std::size_t idx = index(x, height - y - 1);
 
-      buf[base_index] = static_cast<float>(cell.type);
-      buf[base_index + 1] = static_cast<float>(cell.mass);
+      buf[base_index] = static_cast<float>(_grid.type[idx]);
+      buf[base_index + 1] = _grid.mass[idx];
     }
   }
 
-  return {.width = width, .height = height, .stride = stride, .buffer = buf};
+  /* particles in flight show over air cells */
+  for (const particle_t &particle : _particles) {
+    const int x = static_cast<int>(particle.position.x);
+    const int y = static_cast<int>(std::floor(particle.position.y));
+
+    if (y < 0 or _grid.type[index(x, y)] != CellType::AIR)
+      continue;
+
+    const std::uint64_t base_index = ((height - y - 1) * width + x) * stride;
+    buf[base_index] = static_cast<float>(particle.type);
+    buf[base_index + 1] = particle.mass;
+  }
+
+  data.width = width;
+  data.height = height;
+  data.stride = stride;
 }
 
 void Grid::deserialize(const GridBase::serialized_grid_t &data) noexcept {
@@ -195,10 +513,23 @@ void Grid::deserialize(const GridBase::serialized_grid_t &data) noexcept {
           static_cast<std::uint32_t>(data.buffer[base_index]));
       float mass = data.buffer[base_index + 1];
 
-      _grid[height - row - 1][col] = {.type = type,
-                                      .mass = mass,
-                                      .velocity = glm::vec2{0.0f},
-                                      .updated = false};
+      store(_grid, index(col, height - row - 1),
+            {.type = type,
+             .mass = mass,
+             .velocity = glm::vec2{0.0f},
+             .updated = false});
+    }
+  }
+
+  /* loaded grid may be unsettled anywhere, wake every chunk and cell (this
+   * also syncs _next_grid on the next step) */
+  std::fill(_rest.begin(), _rest.end(), 0);
+  _particles.clear();
+  for (std::uint32_t cy = 0; cy < chunks_y; cy += 1) {
+    for (std::uint32_t cx = 0; cx < chunks_x; cx += 1) {
+      _chunks[cy * chunks_x + cx].curr.expand(
+          cx * CHUNK_SIZE, cy * CHUNK_SIZE, (cx + 1) * CHUNK_SIZE - 1,
+          (cy + 1) * CHUNK_SIZE - 1);
     }
   }
 }
@@ -208,7 +539,7 @@ cell_data_t Grid::cell_at(std::uint32_t x, std::uint32_t y,
   if (y >= height || x >= width) [[unlikely]]
     return cell_data_t{};
 
-  return next ? _next_grid[y][x] : _grid[y][x];
+  return load(next ? _next_grid : _grid, index(x, y));
 }
 
 bool Grid::set_next(std::uint32_t x, std::uint32_t y,
@@ -217,7 +548,22 @@ bool Grid::set_next(std::uint32_t x, std::uint32_t y,
     std::cerr << "ERROR::GRID: out of bound: " << x << ' ' << y << std::endl;
     return false;
   } else {
-    _next_grid[y][x] = cell;
+    const std::size_t idx = index(x, y);
+
+    /* only changed cells wake their chunk. neighbors of sleeping cells
+     * only wake them by changing type, or by changing at all when they
+     * can sleep themselves, so e.g. decaying smoke lets sand rest */
+    if (_grid.type[idx] != cell.type) {
+      mark_dirty(x, y, &chunk_t::next);
+      wake(x, y);
+    } else if (_grid.mass[idx] != cell.mass or
+               _grid.velocity[idx] != cell.velocity) {
+      mark_dirty(x, y, &chunk_t::next);
+      if (cpu_dispatch_t::sleep_after_of(cell.type) != UINT8_MAX)
+        wake(x, y);
+    }
+
+    store(_next_grid, idx, cell);
     return true;
   }
 }
@@ -228,9 +574,177 @@ bool Grid::set_curr(std::uint32_t x, std::uint32_t y,
     std::cerr << "ERROR::GRID: out of bound: " << x << ' ' << y << std::endl;
     return false;
   } else {
-    _grid[y][x] = cell;
+    store(_grid, index(x, y), cell);
+    mark_dirty(x, y, &chunk_t::curr);
+    wake(x, y);
     return true;
   }
 }
 
+Grid::sweep_t Grid::sweep(int x0, int y0, int x1, int y1,
+                          Material material) const noexcept {
+  const int dx = std::abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+  const int dy = -std::abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+  int error = dx + dy;
+  int x = x0, y = y0;
+
+  /* ghost cells have no material, so the walk never leaves the grid */
+  while (x != x1 or y != y1) {
+    const int e2 = 2 * error;
+    int nx = x, ny = y;
+
+    if (e2 >= dy) {
+      error += dy;
+      nx += sx;
+    }
+    if (e2 <= dx) {
+      error += dx;
+      ny += sy;
+    }
+
+    if (!has_material(material, nx, ny) or updated(nx, ny))
+      return {.end = {x, y}, .blocker = {nx, ny}};
+
+    x = nx;
+    y = ny;
+  }
+
+  return {.end = {x, y}, .blocker = {x, y}};
+}
+
+bool Grid::eject(std::uint32_t x, std::uint32_t y,
+                 const glm::vec2 velocity) noexcept {
+  if (y >= height || x >= width) [[unlikely]]
+    return false;
+
+  const cell_data_t cell = load(_next_grid, index(x, y));
+  if (cell.type == CellType::AIR)
+    return false;
+
+  const std::size_t bucket = (y / EJECT_SPAN) * eject_stride + x / EJECT_SPAN;
+  _ejected[bucket].push_back({
+      .position = glm::vec2{x + 0.5f, y + 0.5f},
+      .velocity = velocity,
+      .mass = cell.mass,
+      .type = cell.type,
+  });
+
+  set_next(x, y, {.type = CellType::AIR, .updated = true});
+  return true;
+}
+
+void Grid::keep_awake(std::uint32_t x, std::uint32_t y) noexcept {
+  if (y < height and x < width) [[likely]]
+    mark_dirty(x, y, &chunk_t::next);
+}
+
+void Grid::rect_t::expand(std::int32_t x0, std::int32_t y0, std::int32_t x1,
+                          std::int32_t y1) noexcept {
+  /* lock free min/max, most calls do not change the bounds */
+  const auto fetch_min = [](std::atomic<std::int32_t> &bound, std::int32_t v) {
+    std::int32_t curr = bound.load(std::memory_order_relaxed);
+    while (v < curr and
+           !bound.compare_exchange_weak(curr, v, std::memory_order_relaxed))
+      ;
+  };
+
+  const auto fetch_max = [](std::atomic<std::int32_t> &bound, std::int32_t v) {
+    std::int32_t curr = bound.load(std::memory_order_relaxed);
+    while (v > curr and
+           !bound.compare_exchange_weak(curr, v, std::memory_order_relaxed))
+      ;
+  };
+
+  fetch_min(min_x, x0);
+  fetch_min(min_y, y0);
+  fetch_max(max_x, x1);
+  fetch_max(max_y, y1);
+}
+
+void Grid::rect_t::take(rect_t &other) noexcept {
+  min_x.store(other.min_x.exchange(INT32_MAX, std::memory_order_relaxed),
+              std::memory_order_relaxed);
+  min_y.store(other.min_y.exchange(INT32_MAX, std::memory_order_relaxed),
+              std::memory_order_relaxed);
+  max_x.store(other.max_x.exchange(INT32_MIN, std::memory_order_relaxed),
+              std::memory_order_relaxed);
+  max_y.store(other.max_y.exchange(INT32_MIN, std::memory_order_relaxed),
+              std::memory_order_relaxed);
+}
+
+void Grid::mark_dirty(std::uint32_t x, std::uint32_t y,
+                      rect_t chunk_t::*which) noexcept {
+  const std::int32_t x0 = static_cast<std::int32_t>(x) - 1;
+  const std::int32_t y0 = static_cast<std::int32_t>(y) - 1;
+  const std::int32_t x1 = static_cast<std::int32_t>(x) + 1;
+  const std::int32_t y1 = static_cast<std::int32_t>(y) + 1;
+
+  /* 3x3 block touches at most 2x2 chunks */
+  const std::uint32_t cx0 = std::max(x0, 0) / CHUNK_SIZE;
+  const std::uint32_t cy0 = std::max(y0, 0) / CHUNK_SIZE;
+  const std::uint32_t cx1 = std::min<std::uint32_t>(x1 / CHUNK_SIZE, chunks_x - 1);
+  const std::uint32_t cy1 = std::min<std::uint32_t>(y1 / CHUNK_SIZE, chunks_y - 1);
+
+  for (std::uint32_t cy = cy0; cy <= cy1; cy += 1)
+    for (std::uint32_t cx = cx0; cx <= cx1; cx += 1)
+      (_chunks[cy * chunks_x + cx].*which).expand(x0, y0, x1, y1);
+}
+
+void Grid::wake(std::uint32_t x, std::uint32_t y) noexcept {
+  const int x0 = static_cast<int>(x) - 1;
+  const int y0 = static_cast<int>(y) - 1;
+
+  /* block may include ghost cells, their counters are never read */
+  if constexpr (MORTON_LAYOUT) {
+    for (int ny = y0; ny <= y0 + 2; ny += 1)
+      for (int nx = x0; nx <= x0 + 2; nx += 1)
+        _rest[index(nx, ny)] = 0;
+  } else {
+    std::uint8_t *const rest = &_rest[index(x0, y0)];
+    for (std::size_t row = 0; row < 3; row += 1)
+      std::fill_n(rest + row * row_stride, 3, 0);
+  }
+}
+
+void Grid::touch_span(int x_start, int x_end, int y) noexcept {
+  const int x0 = x_start - 1, y0 = y - 1;
+  const int x1 = x_end, y1 = y + 1; /* inclusive */
+
+  /* same as mark_dirty and wake over each cell, a chunk at a time */
+  const std::uint32_t cx0 = std::max(x0, 0) / CHUNK_SIZE;
+  const std::uint32_t cy0 = std::max(y0, 0) / CHUNK_SIZE;
+  const std::uint32_t cx1 = std::min<std::uint32_t>(x1 / CHUNK_SIZE, chunks_x - 1);
+  const std::uint32_t cy1 = std::min<std::uint32_t>(y1 / CHUNK_SIZE, chunks_y - 1);
+
+  for (std::uint32_t cy = cy0; cy <= cy1; cy += 1)
+    for (std::uint32_t cx = cx0; cx <= cx1; cx += 1)
+      _chunks[cy * chunks_x + cx].curr.expand(x0, y0, x1, y1);
+
+  /* block may include ghost cells, their counters are never read */
+  for (int ny = y0; ny <= y1; ny += 1) {
+    if constexpr (MORTON_LAYOUT) {
+      for (int nx = x0; nx <= x1; nx += 1)
+        _rest[index(nx, ny)] = 0;
+    } else {
+      std::fill_n(&_rest[index(x0, ny)], x1 - x0 + 1, 0);
+    }
+  }
+}
+
+cell_data_t Grid::load(const grid_data_t &planes,
+                       const std::size_t idx) const noexcept {
+  return {.type = planes.type[idx],
+          .mass = planes.mass[idx],
+          .velocity = planes.velocity[idx],
+          .updated = planes.stamp[idx] == generation};
+}
+
+void Grid::store(grid_data_t &planes, const std::size_t idx,
+                 const cell_data_t &cell) noexcept {
+  planes.type[idx] = cell.type;
+  planes.mass[idx] = cell.mass;
+  planes.velocity[idx] = cell.velocity;
+  planes.stamp[idx] = cell.updated ? generation : 0;
+}
+
 } // namespace simulake
@@ -1,12 +1,19 @@
 #ifndef SIMULAKE_GRID_HPP
 #define SIMULAKE_GRID_HPP
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <random>
 #include <vector>
 
+#include "brush_raster.hpp"
 #include "cell.hpp"
 #include "grid_base.hpp"
+#include "random.hpp"
+#include "scheduler.hpp"
 
 namespace simulake {
 
@@ -14,6 +21,13 @@ namespace simulake {
 
 class Grid : public GridBase {
 public:
+  /* order in which cells inside a chunk's rect are stepped */
+  enum class Traversal : std::uint8_t {
+    COLUMNS, /* x outer, y inner (strides a row per cell) */
+    ROWS,    /* rows bottom-up, direction alternates per row and frame */
+    TILES,   /* TILE_SIZE blocks bottom-up, rows (as ROWS) inside each */
+  };
+
   /* default: initialize empty grid */
   explicit Grid(const std::uint32_t, const std::uint32_t);
   ~Grid() = default;
@@ -36,6 +50,9 @@ public:
   void spawn_cells(const std::tuple<std::uint32_t, std::uint32_t> &,
                    const std::uint32_t, const CellType) noexcept override;
 
+  /* paint the spans of a brush batch, a run of cells at a time */
+  void paint_cells(const paint_mask_t &) noexcept override;
+
   /* is not device grid */
   constexpr bool is_device_grid() const noexcept override { return false; }
 
@@ -46,8 +63,8 @@ public:
   /* accessor method for stride between serialized buffer items */
   inline std::uint32_t get_stride() const noexcept override { return stride; }
 
-  /* saves grid to float buffer */
-  serialized_grid_t serialize() const noexcept override;
+  /* saves grid into float buffer */
+  void serialize_into(serialized_grid_t &) const noexcept override;
 
   /* loads grid from float buffer */
   void deserialize(const serialized_grid_t &) noexcept override;
@@ -55,12 +72,113 @@ public:
   /* get cell type at given position */
   cell_data_t cell_at(std::uint32_t, std::uint32_t, bool = false) const noexcept;
 
+  /* unchecked reads for cell rules. x, y may be at most one cell outside the
+   * grid, those ghost cells read as CellType::NONE (same as cell_at) */
+  inline cell_data_t unchecked_cell_at(int x, int y,
+                                       bool next = false) const noexcept {
+    return load(next ? _next_grid : _grid, index(x, y));
+  }
+
+  inline CellType unchecked_type_at(int x, int y,
+                                    bool next = false) const noexcept {
+    return (next ? _next_grid : _grid).type[index(x, y)];
+  }
+
+  inline float unchecked_mass_at(int x, int y,
+                                 bool next = false) const noexcept {
+    return (next ? _next_grid : _grid).mass[index(x, y)];
+  }
+
+  /* material bits of the 64 cells (x0 + i, y), i in [0, 64), from the bit
+   * planes. -64 <= x0 < width and -1 <= y <= height, cells outside the grid
+   * read as 0. planes reflect the grid as of the start of the step */
+  inline std::uint64_t material_bits(Material material, int x0,
+                                     int y) const noexcept {
+    const auto &plane = _materials[static_cast<std::size_t>(material)];
+    const std::size_t word = material_index(x0, y);
+    const int shift = x0 & 63;
+
+    if (shift == 0)
+      return plane[word];
+
+    return (plane[word] >> shift) | (plane[word + 1] << (64 - shift));
+  }
+
+  /* bit i set iff cell (x0 + i, y) has the given type and is awake, for
+   * cells in [x_start, x_end) of row y, where x0 = x_start & ~63 and
+   * x_end <= x0 + 64. read from the type planes, so only types the cpu grid
+   * steps (stepping other than Stepping::NONE) can be queried */
+  inline std::uint64_t type_bits(CellType type, int x_start, int x_end,
+                                 int y) const noexcept {
+    const auto &plane = _types[static_cast<std::size_t>(type)];
+    return plane[material_index(x_start, y)] & span_mask(x_start, x_end);
+  }
+
+  /* bit i set iff cell (x0 + i, y) was updated this frame */
+  std::uint64_t updated_bits(int, int) const noexcept;
+
+  /* material bit of a single cell, -1 <= x <= width and -1 <= y <= height */
+  inline bool has_material(Material material, int x, int y) const noexcept {
+    const auto &plane = _materials[static_cast<std::size_t>(material)];
+    return (plane[material_index(x, y)] >> (x & 63)) & 1;
+  }
+
   /* set cell type at given position. returns true of successful */
   bool set_next(std::uint32_t, std::uint32_t, const cell_data_t) noexcept;
   bool set_curr(std::uint32_t, std::uint32_t, const cell_data_t) noexcept;
 
+  /* result of a sweep, see sweep */
+  struct sweep_t {
+    glm::ivec2 end;     /* last open cell reached, the start if none */
+    glm::ivec2 blocker; /* cell the walk stopped at, end if it got through */
+  };
+
+  /* walk the line from (x0, y0) to (x1, y1) (Bresenham), over cells having
+   * the given material at the start of the step and not updated since. the
+   * start cell itself is not checked. the end must be in reach of the cell
+   * being stepped (see max_velocity), cells outside the grid block */
+  sweep_t sweep(int, int, int, int,
+                Material = Material::EMPTY) const noexcept;
+
+  /* step cell (and neighbors) next frame even if it did not change */
+  void keep_awake(std::uint32_t, std::uint32_t) noexcept;
+
+  /* lift the next state of cell (x, y) out of the grid as a free particle
+   * with the given velocity (cells per frame), leaving air behind. it flies
+   * ballistically and lands back in the grid, see step_particles. returns
+   * false (and does nothing) for air and out of bounds cells */
+  bool eject(std::uint32_t, std::uint32_t, const glm::vec2) noexcept;
+
+  /* number of ejected cells in flight */
+  inline std::size_t num_particles() const noexcept {
+    return _particles.size();
+  }
+
   inline float get_delta_time() { return delta_time; }
 
+  /* select cell traversal order, takes effect next step */
+  inline void set_traversal(const Traversal order) noexcept {
+    traversal = order;
+  }
+  inline Traversal get_traversal() const noexcept { return traversal; }
+
+  /* number of threads stepping chunks, takes effect next step */
+  inline void set_thread_count(const std::uint32_t count) noexcept {
+    scheduler->set_thread_count(count);
+  }
+  inline std::uint32_t get_thread_count() const noexcept {
+    return scheduler->get_thread_count();
+  }
+
+  /* random stream for a cell this frame. spawn draws use their own stream so
+   * they do not repeat the draws of the following step */
+  static constexpr std::uint32_t SPAWN_STREAM = 1;
+  static constexpr std::uint32_t ROW_STREAM = 2; /* word-wide rules */
+  inline rng_t rng_at(std::uint32_t x, std::uint32_t y,
+                      std::uint32_t stream = 0) const noexcept {
+    return {frame_key, rng_cell_counter(x, y) + (stream << 12)};
+  }
+
   /* check if x, y is inside the grid */
   inline bool in_bounds(std::uint32_t x, std::uint32_t y) {
     return x >= 0 and y >= 0 and x < width and y < height;
@@ -68,55 +186,265 @@ public:
 
   /* check if x, y is inside the grid */
   inline bool is_empty(std::uint32_t x, std::uint32_t y) {
-    return in_bounds(x, y) and _grid[y][x].type == CellType::AIR;
+    return in_bounds(x, y) and _grid.type[index(x, y)] == CellType::AIR;
   }
 
-  /* check if any of 8 neighboring cells are liquid, return
-   * ivec3 with 1 in first pos denoting if liquid was found, and
-   * the x, y coord of the liquid or all zeros if not. */
-  inline glm::ivec3 is_in_liquid(std::uint32_t x, std::uint32_t y) {
-    for (int dx = -1; dx <= 1; ++dx) {
-      for (int dy = -1; dy <= 1; ++dy) {
-        int ny = y + dy;
-        int nx = x + dx;
+  inline void mark_updated(std::uint32_t x, std::uint32_t y) {
+    _grid.stamp[index(x, y)] = generation;
+  }
+
+  inline bool updated(std::uint32_t x, std::uint32_t y) const {
+    return _grid.stamp[index(x, y)] == generation;
+  }
 
-        // Skip the original cell
-        if (dx == 0 && dy == 0 || !in_bounds(nx, ny)) {
-          continue;
-        }
+private:
+  /* grid is represented as a structure of arrays, one contiguous plane per
+   * cell attribute, each addressed through index(x, y). planes include a
+   * one cell border of CellType::NONE ghost cells (x or y in {-1, size}),
+   * which is never written, so rules can read neighbors unchecked */
+  static constexpr std::uint8_t MAX_GENERATION = UINT8_MAX;
+  static constexpr std::uint32_t STAMP_STRIPES = 128; /* < MAX_GENERATION */
+
+  struct grid_data_t {
+    std::vector<CellType> type;
+    std::vector<float> mass;
+    std::vector<glm::vec2> velocity;
+
+    /* generation in which the cell was last updated. a cell is updated iff
+     * its stamp equals the current generation, so nothing needs clearing
+     * per step (see expire_stamps) */
+    std::vector<std::uint8_t> stamp;
+
+    /* resize all planes and fill with the given (never updated) cell */
+    void assign(const std::size_t, const cell_data_t &) noexcept;
+  };
+
+  /* grid is split into CHUNK_SIZE x CHUNK_SIZE chunks, each tracking the
+   * rect of cells that changed (plus their neighbors). only cells inside
+   * the rect are stepped, chunks with an empty rect are asleep.
+   *
+   * chunks are stepped in parallel in 4 checkerboard phases, so no two
+   * chunks stepped concurrently are neighbors. rules may therefore read and
+   * write less than CHUNK_SIZE / 2 cells away from the cell being stepped,
+   * a write also marks the cells around it dirty */
+  static constexpr std::uint32_t CHUNK_SIZE = 64;
+  static constexpr std::uint32_t NUM_PHASES = 4;
+  static_assert(BaseCell::max_velocity < CHUNK_SIZE / 2);
+
+  /* block size of Traversal::TILES, a tile is contiguous in morton layout */
+  static constexpr std::uint32_t TILE_SIZE = 8;
+
+  /* cell layout of the planes (in coordinates shifted by the ghost border),
+   * selected at build time
+   *   row major: (y * row_stride + x)
+   *   morton:    blocks row major, cells inside a CHUNK_SIZE block in
+   *              Z-order, so the 8 neighbors of a cell mostly share its
+   *              cache lines */
+#if SIMULAKE_MORTON_LAYOUT
+  static constexpr bool MORTON_LAYOUT = true;
+#else
+  static constexpr bool MORTON_LAYOUT = false;
+#endif
 
-        CellType type = cell_at(nx, ny).type;
+  /* inclusive cell bounds, empty when min > max. bounds are atomic because
+   * neighboring chunks stepped in the same phase may expand the same rect */
+  struct rect_t {
+    std::atomic<std::int32_t> min_x = INT32_MAX, min_y = INT32_MAX;
+    std::atomic<std::int32_t> max_x = INT32_MIN, max_y = INT32_MIN;
 
-        if (BaseCell::is_liquid(type)) {
-          return glm::ivec3(1, nx, ny);
-        }
-      }
+    inline bool empty() const noexcept {
+      return min_x.load(std::memory_order_relaxed) >
+             max_x.load(std::memory_order_relaxed);
     }
 
-    return glm::ivec3(0, 0, 0);
+    void expand(std::int32_t, std::int32_t, std::int32_t,
+                std::int32_t) noexcept;
+
+    /* copy bounds from other rect, then clear other rect */
+    void take(rect_t &) noexcept;
+  };
+
+  struct chunk_t {
+    rect_t curr; /* cells to step this frame */
+    rect_t next; /* cells changed this frame, stepped next frame */
+  };
+
+  /* expand dirty rect of every chunk touching the 3x3 block around (x, y) */
+  void mark_dirty(std::uint32_t, std::uint32_t, rect_t chunk_t::*) noexcept;
+
+  /* reset rest counters of the 3x3 block around (x, y), see _rest */
+  void wake(std::uint32_t, std::uint32_t) noexcept;
+
+  /* mark_dirty (current rects) and wake for every cell of row y in
+   * [x_start, x_end) */
+  void touch_span(int, int, int) noexcept;
+
+  /* fill cells [x_start, x_end) of row y with Cell::spawn, overwriting all
+   * cells when Cell is air and only air cells otherwise */
+  template <typename Cell> void fill_span(int, int, int) noexcept;
+
+  /* given chunk's current rect clamped to chunk and grid bounds, as
+   * half-open (x_start, y_start, x_end, y_end) */
+  std::tuple<int, int, int, int> clamped_rect(std::uint32_t,
+                                              std::uint32_t) const noexcept;
+
+  /* zero the next stripe of stamps, so that no stamp outlives a full cycle
+   * of generations and aliases a later one */
+  void expire_stamps() noexcept;
+
+  /* copy given chunk's current rect from _grid into _next_grid, and
+   * refresh the material and type words of its rows */
+  void sync_chunk(std::uint32_t, std::uint32_t) noexcept;
+
+  /* step all cells inside the given chunk's current rect */
+  void step_chunk(std::uint32_t, std::uint32_t) noexcept;
+
+  /* step Stepping::CELL cells of row y in [x_start, x_end), direction given
+   * by parity. other cells are skipped through _cell_plane, unvisited */
+  void step_row(int, int, int, bool) noexcept;
+
+  /* step a single Stepping::CELL cell, dispatch on its type */
+  void step_cell(int, int) noexcept;
+
+  /* a cell in flight, outside of the grid planes */
+  struct particle_t {
+    glm::vec2 position; /* cell (x, y) spans [x, x + 1) x [y, y + 1) */
+    glm::vec2 velocity; /* cells per frame */
+    float mass;
+    CellType type;
+  };
+
+  /* fastest a particle moves, in cells per frame */
+  static constexpr float MAX_PARTICLE_SPEED = BaseCell::max_velocity;
+
+  /* collect this frame's ejected cells, then move all particles along
+   * their paths. particles land in the last air cell before the first
+   * blocker. runs on one thread, after the chunks are stepped */
+  void step_particles() noexcept;
+
+  /* spread the low 6 bits of v to the even bits of the result */
+  static constexpr std::uint32_t morton_spread(std::uint32_t v) noexcept {
+    v &= 0x3F;
+    v = (v | (v << 4)) & 0x30F;
+    v = (v | (v << 2)) & 0x333;
+    v = (v | (v << 1)) & 0x555;
+    return v;
   }
 
-  inline void mark_updated(std::uint32_t x, std::uint32_t y) {
-    _grid[y][x].updated = true;
+  /* word of the material planes holding cell (x, y). rows have a ghost
+   * word on either side and a ghost row above and below */
+  inline std::size_t material_index(int x, int y) const noexcept {
+    return static_cast<std::size_t>(y + 1) * material_stride + (x >> 6) + 1;
   }
 
-  inline bool updated(std::uint32_t x, std::uint32_t y) {
-    return _grid[y][x].updated;
+  /* bits [x_start, x_end) of the word holding x_start, the span must be non
+   * empty and inside that word */
+  static constexpr std::uint64_t span_mask(int x_start, int x_end) noexcept {
+    return (~std::uint64_t{0} >> (64 - (x_end - x_start))) << (x_start & 63);
   }
 
-private:
-  /* grid is represented as a 2D array of cell_data_t */
-  typedef std::vector<std::vector<cell_data_t>> grid_data_t;
+  /* rebuild material and type words of chunk column cx for rows
+   * [y_start, y_end) */
+  void update_planes(std::uint32_t, int, int) noexcept;
+
+  /* flat index of cell (x, y) into the planes, -1 <= x <= width and
+   * -1 <= y <= height */
+  inline std::size_t index(int x, int y) const noexcept {
+    const std::uint32_t px = static_cast<std::uint32_t>(x + 1);
+    const std::uint32_t py = static_cast<std::uint32_t>(y + 1);
+
+    if constexpr (MORTON_LAYOUT) {
+      static_assert(CHUNK_SIZE == 64, "morton_spread covers 6 bits");
+
+      const std::size_t block =
+          (py / CHUNK_SIZE) * row_stride + px / CHUNK_SIZE;
+      return block * CHUNK_SIZE * CHUNK_SIZE +
+             (morton_spread(px % CHUNK_SIZE) |
+              (morton_spread(py % CHUNK_SIZE) << 1));
+    } else {
+      return static_cast<std::size_t>(py) * row_stride + px;
+    }
+  }
+
+  /* gather / scatter a cell from / into planes at given index, the updated
+   * bit is relative to the current frame */
+  cell_data_t load(const grid_data_t &, const std::size_t) const noexcept;
+  void store(grid_data_t &, const std::size_t, const cell_data_t &) noexcept;
 
-  /* buffers */
+  /* buffers. both agree everywhere outside the chunks' current rects, so
+   * only those are synced before each step (see simulate) */
   grid_data_t _grid;      // completed last grid
   grid_data_t _next_grid; // next grid being computed, swap at end of simulate
 
+  /* material bit planes, one per Material. bit x % 64 of material_index(x,
+   * y) is cell (x, y). like _next_grid, they are only refreshed over the
+   * chunks' current rects at the start of each step */
+  static_assert(CHUNK_SIZE == 64, "a chunk row is one material word");
+  std::array<std::vector<std::uint64_t>,
+             static_cast<std::size_t>(Material::COUNT)>
+      _materials;
+  std::uint32_t material_stride; /* words per row, including ghost words */
+
+  /* type bit planes, indexed by CellType, same layout and refresh as the
+   * material planes. only types the cpu grid steps have a plane, so rules
+   * find their own cells a word at a time (see type_bits). sleeping cells
+   * are left out */
+  static constexpr std::size_t NUM_TYPES =
+      static_cast<std::size_t>(CellType::STONE) + 1; /* last CellType */
+  std::array<std::vector<std::uint64_t>, NUM_TYPES> _types;
+
+  /* union of the Stepping::CELL type planes, the per cell pass visits only
+   * these cells, so its cost follows the number of live cells (e.g. fire)
+   * rather than the area of the awake rects */
+  std::vector<std::uint64_t> _cell_plane;
+
+  /* rest counters, indexed like the grid planes: frames since the cell or
+   * one of its neighbors last changed (see set_next), saturating. each
+   * refresh of the planes ages the refreshed cells, wake resets them. cells
+   * that rested longer than their type's sleep_after are asleep */
+  std::vector<std::uint8_t> _rest;
+
+  /* rasterizes spawn_cells discs, keeps its span tables between calls */
+  BrushRaster _raster;
+
+  /* particles in flight, in the order they were ejected */
+  std::vector<particle_t> _particles;
+
+  /* particles ejected this frame, bucketed by the EJECT_SPAN block of the
+   * ejected cell (row major, eject_stride buckets per row). rules reach at
+   * most CHUNK_SIZE / 2 cells, so chunks stepped concurrently never eject
+   * into the same bucket and appending needs no lock. buckets are drained
+   * in order, independent of thread scheduling */
+  static constexpr std::uint32_t EJECT_SPAN = CHUNK_SIZE / 2;
+  std::vector<std::vector<particle_t>> _ejected;
+  std::uint32_t eject_stride;
+
+  /* steps the chunks of each phase, see simulate */
+  std::unique_ptr<Scheduler> scheduler;
+
+  /* chunks, row major (chunks_x * chunks_y) */
+  std::vector<chunk_t> _chunks;
+  std::vector<std::uint32_t> _phase_chunks[NUM_PHASES]; /* awake, per phase */
+  std::uint32_t chunks_x;
+  std::uint32_t chunks_y;
+
   std::uint32_t width;
   std::uint32_t height;
   std::uint32_t stride;
+  std::uint32_t row_stride; /* cells (morton: blocks) between rows */
+  std::size_t num_cells;    /* size of each plane, including padding */
 
   float delta_time = 0.0f;
+  Traversal traversal = Traversal::ROWS;
+
+  /* generation stamped on cells updated in the frame being (or about to be)
+   * simulated. 0 is reserved for cells that were not updated recently */
+  std::uint8_t generation = 1;
+
+  /* random number generator state, see random.hpp */
+  std::uint64_t seed;
+  std::uint32_t frame = 0;
+  std::uint64_t frame_key;
 };
 
 } /* namespace simulake */
@@ -11,10 +11,31 @@ namespace simulake {
 class GridBase {
 public:
   struct serialized_grid_t {
-    std::uint32_t width;        /* number of grid columns */
-    std::uint32_t height;       /* number of grid rows */
-    std::uint32_t stride;       /* number of floats per cell */
-    std::vector<float> buffer;  /* 1D buffer of grid data */
+    /* save format, bumped when the buffer layout changes. version 1 saves
+     * have no header and device grids stored their cells column major */
+    static constexpr std::uint32_t VERSION = 2;
+
+    std::uint32_t version = VERSION; /* format of the buffer */
+    std::uint32_t width = 0;         /* number of grid columns */
+    std::uint32_t height = 0;        /* number of grid rows */
+    std::uint32_t stride = 0;        /* number of floats per cell */
+    std::vector<float> buffer;       /* 1D buffer of grid data */
+  };
+
+  /* painted cells [x_begin, x_end) of row y */
+  struct paint_span_t {
+    std::uint32_t y;
+    std::uint32_t x_begin;
+    std::uint32_t x_end;
+  };
+
+  /* cells painted by one brush batch, as disjoint spans sorted by row, and
+   * their bounding box (see BrushRaster) */
+  struct paint_mask_t {
+    std::vector<paint_span_t> spans;
+    std::uint32_t x = 0, y = 0;          /* top left cell of the box */
+    std::uint32_t width = 0, height = 0; /* size of the box in cells */
+    CellType target = CellType::NONE;
   };
 
   virtual ~GridBase() = default;
@@ -31,6 +52,10 @@ public:
                            const std::uint32_t paint_radius,
                            const CellType paint_target) noexcept = 0;
 
+  /* paint all covered cells of mask at once, AIR erases any cell, other
+   * types only fill AIR cells */
+  virtual void paint_cells(const paint_mask_t &mask) noexcept = 0;
+
   /* accessor methods for grid dimensions */
   virtual std::uint32_t get_width() const noexcept = 0;
   virtual std::uint32_t get_height() const noexcept = 0;
@@ -42,7 +67,14 @@ public:
   virtual std::uint32_t get_stride() const noexcept = 0;
 
   /* saves grid to float buffer */
-  virtual serialized_grid_t serialize() const noexcept = 0;
+  inline serialized_grid_t serialize() const noexcept {
+    serialized_grid_t data;
+    serialize_into(data);
+    return data;
+  }
+
+  /* saves grid into given float buffer, reusing its storage */
+  virtual void serialize_into(serialized_grid_t &data) const noexcept = 0;
 
   /* loads grid from float buffer */
   virtual void deserialize(const serialized_grid_t &data) noexcept = 0;
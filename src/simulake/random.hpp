@@ -0,0 +1,41 @@
+#ifndef SIMULAKE_RANDOM_HPP
+#define SIMULAKE_RANDOM_HPP
+
+#include <cstdint>
+
+/* NOTE(vir): same generator as the opencl kernels */
+#include "random.cl"
+
+namespace simulake {
+
+/* random stream of a single cell update. copies are independent, draws only
+ * advance the local counter so streams can live on any thread */
+struct rng_t {
+  std::uint64_t key;     /* per frame key, see rng_frame_key */
+  std::uint64_t counter; /* next counter, see rng_cell_counter */
+
+  inline std::uint32_t next() noexcept {
+    return rng_squares32(counter++, key);
+  }
+
+  /* 64 random bits, e.g. a per word mask */
+  inline std::uint64_t next_bits() noexcept {
+    const std::uint64_t hi = next();
+    return (hi << 32) | next();
+  }
+
+  /* uniform float in [lower, upper) */
+  inline float next_float(float lower, float upper) noexcept {
+    return lower + rng_to_float(next()) * (upper - lower);
+  }
+
+  /* uniform int in [lower, upper] */
+  inline int next_int(int lower, int upper) noexcept {
+    const std::uint64_t range = static_cast<std::uint64_t>(upper - lower) + 1;
+    return lower + static_cast<int>((next() * range) >> 32);
+  }
+};
+
+} /* namespace simulake */
+
+#endif
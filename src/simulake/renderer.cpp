@@ -133,11 +133,14 @@ void Renderer::submit_grid(GridBase *grid) noexcept {
   }
 
   /* update cpu grid texture */
-  if (!is_device_grid) {
-    const auto data = grid->serialize();
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, data.width, data.height, 0, GL_RG,
-                 GL_FLOAT, data.buffer.data());
-  }
+  if (!is_device_grid)
+    submit_grid(grid->serialize());
+}
+
+void Renderer::submit_grid(
+    const GridBase::serialized_grid_t &data) const noexcept {
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, data.width, data.height, 0, GL_RG,
+               GL_FLOAT, data.buffer.data());
 }
 
 void Renderer::render() const noexcept {
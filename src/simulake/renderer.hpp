@@ -31,6 +31,9 @@ public:
   /* submit new grid data to renderer */
   void submit_grid(GridBase *) noexcept;
 
+  /* upload a serialized cpu grid frame, of the submitted grid's size */
+  void submit_grid(const GridBase::serialized_grid_t &) const noexcept;
+
   enum class UniformId {
     CELL_SIZE, SPAWN_RADIUS, MOUSE_POS, RESOLUTION, GRID_DIM, TIME
   };
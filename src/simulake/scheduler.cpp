@@ -0,0 +1,52 @@
+#include "scheduler.hpp"
+
+namespace simulake {
+
+Scheduler::Scheduler(const std::uint32_t num_threads)
+    : pool(num_threads), thread_count(pool.get_thread_count()) {
+  ranges = std::make_unique<range_t[]>(thread_count);
+}
+
+void Scheduler::set_thread_count(const std::uint32_t num_threads) noexcept {
+  pool.reset(num_threads);
+  thread_count = pool.get_thread_count();
+  ranges = std::make_unique<range_t[]>(thread_count);
+}
+
+bool Scheduler::pop(const std::uint32_t worker, std::uint32_t &i) noexcept {
+  auto &bits = ranges[worker].bits;
+  std::uint64_t curr = bits.load(std::memory_order_relaxed);
+
+  while (true) {
+    const std::uint32_t begin = curr >> 32, end = curr & UINT32_MAX;
+    if (begin >= end)
+      return false;
+
+    const std::uint64_t next =
+        (static_cast<std::uint64_t>(begin + 1) << 32) | end;
+    if (bits.compare_exchange_weak(curr, next, std::memory_order_relaxed)) {
+      i = begin;
+      return true;
+    }
+  }
+}
+
+bool Scheduler::steal(const std::uint32_t victim, std::uint32_t &i) noexcept {
+  auto &bits = ranges[victim].bits;
+  std::uint64_t curr = bits.load(std::memory_order_relaxed);
+
+  while (true) {
+    const std::uint32_t begin = curr >> 32, end = curr & UINT32_MAX;
+    if (begin >= end)
+      return false;
+
+    const std::uint64_t next =
+        (static_cast<std::uint64_t>(begin) << 32) | (end - 1);
+    if (bits.compare_exchange_weak(curr, next, std::memory_order_relaxed)) {
+      i = end - 1;
+      return true;
+    }
+  }
+}
+
+} /* namespace simulake */
@@ -0,0 +1,105 @@
+#ifndef SIMULAKE_SCHEDULER_HPP
+#define SIMULAKE_SCHEDULER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "threadpool/bs_threadpool.hpp"
+
+namespace simulake {
+
+/* Scheduler runs batches of independent tasks (e.g. the chunks of one
+ * checkerboard phase) on a thread pool, balanced by work stealing.
+ *
+ * each batch is split into one contiguous range of task indices per worker.
+ * a worker takes tasks from the front of its own range, and once that is
+ * empty steals from the back of the others, so a few expensive tasks (a
+ * fire front) do not leave the other workers idle */
+class Scheduler {
+public:
+  /* default: one worker per hardware thread */
+  explicit Scheduler(const std::uint32_t = 0);
+  ~Scheduler() = default;
+
+  /* disable moves, workers point into the scheduler */
+  explicit Scheduler(Scheduler &&) = delete;
+  Scheduler &operator=(Scheduler &&) = delete;
+
+  /* disable copies */
+  explicit Scheduler(const Scheduler &) = delete;
+  Scheduler &operator=(const Scheduler &) = delete;
+
+  /* run task(i) for every i in [0, count), in any order and on any worker.
+   * returns once all tasks are done */
+  template <typename F> void run(const std::uint32_t, F &&) noexcept;
+
+  /* number of workers, waits for running tasks before changing it */
+  inline std::uint32_t get_thread_count() const noexcept {
+    return thread_count;
+  }
+  void set_thread_count(const std::uint32_t) noexcept;
+
+private:
+  /* remaining task range [begin, end) of a worker, packed as begin << 32 |
+   * end so that owner and thieves agree through a single atomic. on its own
+   * cache line, owners update it for every task */
+  struct alignas(64) range_t {
+    std::atomic<std::uint64_t> bits = 0;
+  };
+
+  /* take the first task of worker's range, false if it is empty */
+  bool pop(const std::uint32_t, std::uint32_t &) noexcept;
+
+  /* take the last task of victim's range, false if it is empty */
+  bool steal(const std::uint32_t, std::uint32_t &) noexcept;
+
+  /* run worker's own tasks, then steal from the others until all are done.
+   * ranges only shrink during a batch, so one pass over the victims is
+   * enough */
+  template <typename F>
+  void work(const std::uint32_t worker, const std::uint32_t workers,
+            F &task) noexcept {
+    std::uint32_t i;
+
+    while (pop(worker, i))
+      task(i);
+
+    for (std::uint32_t k = 1; k < workers; k += 1) {
+      while (steal((worker + k) % workers, i))
+        task(i);
+    }
+  }
+
+  BS::thread_pool pool;
+  std::unique_ptr<range_t[]> ranges; /* one per worker */
+  std::uint32_t thread_count;
+};
+
+template <typename F>
+void Scheduler::run(const std::uint32_t count, F &&task) noexcept {
+  const std::uint32_t workers = std::min(thread_count, count);
+
+  /* NOTE(vir): small batches are not worth waking the pool for */
+  if (workers <= 1) {
+    for (std::uint32_t i = 0; i < count; i += 1)
+      task(i);
+    return;
+  }
+
+  for (std::uint32_t w = 0; w < workers; w += 1) {
+    const std::uint64_t begin = static_cast<std::uint64_t>(count) * w / workers;
+    const std::uint64_t end =
+        static_cast<std::uint64_t>(count) * (w + 1) / workers;
+    ranges[w].bits.store((begin << 32) | end, std::memory_order_relaxed);
+  }
+
+  for (std::uint32_t w = 0; w < workers; w += 1)
+    pool.push_task([this, w, workers, &task] { work(w, workers, task); });
+
+  pool.wait_for_tasks();
+}
+
+} /* namespace simulake */
+
+#endif
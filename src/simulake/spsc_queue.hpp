@@ -0,0 +1,49 @@
+#ifndef SIMULAKE_SPSC_QUEUE_HPP
+#define SIMULAKE_SPSC_QUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace simulake {
+
+/* SpscQueue is a bounded ring buffer between one producer thread and one
+ * consumer thread, without locks. each side only writes its own index, and
+ * publishes it with release after touching the slot */
+template <typename T, std::uint32_t N> class SpscQueue {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of 2");
+
+public:
+  /* append item, false (and item dropped) if the queue is full */
+  inline bool push(const T &item) noexcept {
+    const std::uint32_t tail = write.load(std::memory_order_relaxed);
+    if (tail - read.load(std::memory_order_acquire) == N)
+      return false;
+
+    slots[tail & (N - 1)] = item;
+    write.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /* take the oldest item, false if the queue is empty */
+  inline bool pop(T &item) noexcept {
+    const std::uint32_t head = read.load(std::memory_order_relaxed);
+    if (head == write.load(std::memory_order_acquire))
+      return false;
+
+    item = slots[head & (N - 1)];
+    read.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  std::array<T, N> slots;
+
+  /* free running counters, wrap around together */
+  alignas(64) std::atomic<std::uint32_t> write = 0; /* producer only */
+  alignas(64) std::atomic<std::uint32_t> read = 0;  /* consumer only */
+};
+
+} /* namespace simulake */
+
+#endif
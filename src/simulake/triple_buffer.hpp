@@ -0,0 +1,55 @@
+#ifndef SIMULAKE_TRIPLE_BUFFER_HPP
+#define SIMULAKE_TRIPLE_BUFFER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace simulake {
+
+/* TripleBuffer hands completed frames from one producer thread to one
+ * consumer thread without locks. neither side ever waits: the producer
+ * always owns a slot to write the next frame into, the consumer always owns
+ * the latest frame it took, and the third slot is swapped between them.
+ * frames the consumer was too slow to take are overwritten */
+template <typename T> class TripleBuffer {
+public:
+  /* slot the producer writes the next frame into */
+  inline T &back() noexcept { return slots[back_index]; }
+
+  /* publish the back slot as the latest frame, the producer continues in
+   * the slot the consumer released (or the unread stale frame) */
+  inline void publish() noexcept {
+    back_index =
+        middle.exchange(back_index | FRESH, std::memory_order_acq_rel) & INDEX;
+  }
+
+  /* take the latest published frame into front, false (and front
+   * unchanged) if nothing was published since the last call */
+  inline bool update() noexcept {
+    if ((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+      return false;
+
+    front_index =
+        middle.exchange(front_index, std::memory_order_acq_rel) & INDEX;
+    return true;
+  }
+
+  /* slot the consumer reads, valid until the next update */
+  inline const T &front() const noexcept { return slots[front_index]; }
+
+private:
+  /* middle holds a slot index, plus FRESH while it holds an unread frame */
+  static constexpr std::uint8_t INDEX = 0b011;
+  static constexpr std::uint8_t FRESH = 0b100;
+
+  std::array<T, 3> slots;
+
+  alignas(64) std::atomic<std::uint8_t> middle = 1;
+  alignas(64) std::uint8_t back_index = 0; /* producer only */
+  alignas(64) std::uint8_t front_index = 2; /* consumer only */
+};
+
+} /* namespace simulake */
+
+#endif
@@ -1,6 +1,10 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
 #include <iostream>
 #include <thread>
+#include <utility>
 
 #include <omp.h>
 
@@ -200,5 +204,87 @@ namespace test {
 //   glfwTerminate();
 // }
 
+void bench_device_layouts(const std::uint32_t width, const std::uint32_t height,
+                          const std::uint32_t steps,
+                          const DeviceGrid::device_options_t &options) {
+  constexpr auto CELL_SIZE = 1;
+  constexpr std::pair<DeviceGrid::Layout, const char *> LAYOUTS[] = {
+      {DeviceGrid::Layout::CELLS, "cells"},
+      {DeviceGrid::Layout::PLANES, "planes"},
+  };
+
+  for (const auto &[layout, name] : LAYOUTS) {
+    auto grid = DeviceGrid::create(width, height, CELL_SIZE, options, layout);
+    if (grid == nullptr)
+      return;
+
+    // NOTE(vir): no texture target, simulate only steps the grid. the first
+    // step pays for lazy driver setup, leave it out
+    grid->initialize_random();
+    grid->simulate(0.0f);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (std::uint32_t step = 0; step < steps; step += 1)
+      grid->simulate(0.0f);
+
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << name << ": " << elapsed.count() / steps << "ms per step over "
+              << steps << " steps" << std::endl;
+  }
+}
+
+bool check_conservation(const std::uint32_t width, const std::uint32_t height,
+                        const std::uint32_t steps) {
+  constexpr auto DELTA_TIME = 1.0f / 60.0f;
+  constexpr auto MAX_LANDING_STEPS = 600;
+  constexpr auto MASS_TOLERANCE = 0.01; // liquid rules drift a little
+
+  Grid grid(width, height);
+
+  // NOTE(vir): a pool along the floor with sand dropped into it, sand
+  // splashing into the pool throws water up as particles
+  const std::uint32_t radius = std::max(height / 8, 1u);
+  for (std::uint32_t x = 0; x < width; x += radius)
+    grid.spawn_cells({x, height - 1}, radius, CellType::WATER);
+  grid.spawn_cells({width / 2, height / 4}, radius, CellType::SAND);
+
+  const auto totals = [&grid] {
+    std::size_t sand = 0;
+    double water = 0.0;
+    for (std::uint32_t y = 0; y < grid.get_height(); y += 1) {
+      for (std::uint32_t x = 0; x < grid.get_width(); x += 1) {
+        const auto cell = grid.cell_at(x, y);
+        sand += cell.type == CellType::SAND;
+        water += cell.type == CellType::WATER ? cell.mass : 0.0f;
+      }
+    }
+    return std::pair{sand, water};
+  };
+
+  const auto [sand_before, water_before] = totals();
+
+  for (std::uint32_t step = 0; step < steps; step += 1)
+    grid.simulate(DELTA_TIME);
+
+  // particles still in flight are not in the planes, let them land
+  for (int step = 0; step < MAX_LANDING_STEPS and grid.num_particles() > 0;
+       step += 1)
+    grid.simulate(DELTA_TIME);
+
+  const auto [sand_after, water_after] = totals();
+  const bool conserved =
+      sand_after == sand_before and grid.num_particles() == 0 and
+      std::abs(water_after - water_before) <= MASS_TOLERANCE * water_before;
+
+  std::cout << "sand: " << sand_before << " -> " << sand_after
+            << ", water mass: " << water_before << " -> " << water_after
+            << ", particles in flight: " << grid.num_particles() << std::endl;
+  std::cout << (conserved ? "conserved" : "NOT conserved") << " over "
+            << steps << " steps" << std::endl;
+
+  return conserved;
+}
+
 } /* namspace test */
 } /* namespace simulake */
@@ -1,6 +1,10 @@
 #ifndef TEST_HPP
 #define TEST_HPP
 
+#include <cstdint>
+
+#include "simulake/device_grid.hpp"
+
 namespace simulake {
 namespace test {
 
@@ -8,6 +12,16 @@ void test_renderer();
 void test_simulation();
 void test_device_grid();
 
+/* time device grid steps with each cell layout */
+void bench_device_layouts(const std::uint32_t, const std::uint32_t,
+                          const std::uint32_t,
+                          const DeviceGrid::device_options_t &);
+
+/* step a cpu grid of sand dropped into water, true if sand and water mass
+ * are conserved and every ejected particle landed */
+bool check_conservation(const std::uint32_t, const std::uint32_t,
+                        const std::uint32_t);
+
 } /* namespace test */
 } /* namespace simulake */
 
@@ -14,6 +14,10 @@ std::ostream &operator<<(std::ostream &stream,
   stream << "  selected cell type: " << state.get_selected_cell_type() << "\n";
   stream << "  simulation paused: " << state.is_paused() << "\n";
   stream << "  spawn radius: " << state.get_spawn_radius() << "\n";
+  stream << "  brush shape: "
+         << (state.get_brush_shape() == simulake::BrushShape::DISC ? "disc"
+                                                                   : "square")
+         << "\n";
   stream << "  cell size: " << state.get_cell_size() << "\n";
   stream << "  window width: " << state.get_window_width() << "\n";
   stream << "  window height: " << state.get_window_height() << "\n";